@@ -46,12 +46,12 @@ const struct save_type* save_findTag()
 	u32  curAddr = 0x080000C0;
 	char saveTag[16];
 	while (curAddr < 0x08000000+romSize) {
-		u32 fst = *(u32*)curAddr;
+		u32 fst = *(u32*)(uintptr_t)curAddr;
 		// tonccpy(&saveTag, (u8*)curAddr, 16);
-		((u32*)saveTag)[0] = ((u32*)curAddr)[0];
-		((u32*)saveTag)[1] = ((u32*)curAddr)[1];
-		((u32*)saveTag)[2] = ((u32*)curAddr)[2];
-		((u32*)saveTag)[3] = ((u32*)curAddr)[3];
+		((u32*)saveTag)[0] = ((u32*)(uintptr_t)curAddr)[0];
+		((u32*)saveTag)[1] = ((u32*)(uintptr_t)curAddr)[1];
+		((u32*)saveTag)[2] = ((u32*)(uintptr_t)curAddr)[2];
+		((u32*)saveTag)[3] = ((u32*)(uintptr_t)curAddr)[3];
 		enum SaveType type = SAVE_TYPE_NONE;
 		if (fst == 0x53414C46 && (saveTag[5] == '_' || saveTag[5] == '5' || saveTag[5] == '1')) {
 			//FLAS
@@ -76,6 +76,15 @@ const struct save_type* save_findTag()
 	return NULL;
 }
 
+const struct save_type* save_findType(u16 type)
+{
+	for (int i = 0; i < SAVE_TYPE_COUNT; i++) {
+		if (sSaveTypes[i].type == type)
+			return &sSaveTypes[i];
+	}
+	return NULL;
+}
+
 //tonccpy
 //
 void twoByteCpy(u16 *dst, const u16 *src, u32 size){
@@ -87,7 +96,7 @@ void twoByteCpy(u16 *dst, const u16 *src, u32 size){
 	u8  *src8;	  // byte source
 
 	// Ideal case: copy by 4x words. Leaves tail for later.
-	if (((u32)src|(u32)dst) %4 == 0 && size >= 4) {
+	if (((uintptr_t)src|(uintptr_t)dst) %4 == 0 && size >= 4) {
 		u32 *src32= (u32*)src, *dst32= (u32*)dst;
 
 		count = size/4;
@@ -113,7 +122,7 @@ void twoByteCpy(u16 *dst, const u16 *src, u32 size){
 	} else {
 		// Unaligned
 
-		u32 dstOfs = (u32)dst&1;
+		u32 dstOfs = (uintptr_t)dst&1;
 		src8 = (u8*)src;
 		dst16 = (u16*)(dst-dstOfs);
 
@@ -0,0 +1,5 @@
+#pragma once
+
+// Hooks the game's interrupt handler so START+SELECT+A+B goes back to the
+// kernel. SDRAM must be writable.
+void resetPatch(u32 romsize);
@@ -82,7 +82,7 @@ void patchGeneralWhiteScreen()
 	u32 patchOffset = 0x01FFFFDC;
 
 	{
-		vu32 *patchAddr = (vu32*)(0x08000000+patchOffset);
+		vu32 *patchAddr = (vu32*)(uintptr_t)(0x08000000+patchOffset);
 		for(int i=0;i<8;i++){
 			patchAddr[i] = prefetchPatch[i];
 		}
@@ -97,13 +97,13 @@ void patchGeneralWhiteScreen()
 	// General fix for white screen crash
 	// Patch out wait states
 	for (u32 addr = 0x080000C0; addr < searchRange; addr+=4) {
-		if (*(u32*)addr == 0x04000204 &&
-		  (*(u8*)(addr-1) == 0x00 || *(u8*)(addr-1) == 0x03 || *(u8*)(addr-1) == 0x04 || *(u8*)(addr+7) == 0x04
-		  || *(u8*)(addr-1) == 0x08 || *(u8*)(addr-1) == 0x09
-		  || *(u8*)(addr-1) == 0x47 || *(u8*)(addr-1) == 0x81 || *(u8*)(addr-1) == 0x85
-		  || *(u8*)(addr-1) == 0xE0 || *(u8*)(addr-1) == 0xE7 || *(u16*)(addr-2) == 0xFFFE)) 
+		if (*(u32*)(uintptr_t)addr == 0x04000204 &&
+		  (*(u8*)(uintptr_t)(addr-1) == 0x00 || *(u8*)(uintptr_t)(addr-1) == 0x03 || *(u8*)(uintptr_t)(addr-1) == 0x04 || *(u8*)(uintptr_t)(addr+7) == 0x04
+		  || *(u8*)(uintptr_t)(addr-1) == 0x08 || *(u8*)(uintptr_t)(addr-1) == 0x09
+		  || *(u8*)(uintptr_t)(addr-1) == 0x47 || *(u8*)(uintptr_t)(addr-1) == 0x81 || *(u8*)(uintptr_t)(addr-1) == 0x85
+		  || *(u8*)(uintptr_t)(addr-1) == 0xE0 || *(u8*)(uintptr_t)(addr-1) == 0xE7 || *(u16*)(uintptr_t)(addr-2) == 0xFFFE)) 
 		{
-			*(vu32*)addr = 0;
+			*(vu32*)(uintptr_t)addr = 0;
 		}
 	}
 
@@ -155,10 +155,10 @@ void patchSpecificGame(){
 			*(u16*)(0x08000000 + 0xE27E) = 0x400;
 
 			for (int i = 0; i < (int)sizeof(sDbzLoGUPatch1); i += 2)
-				*(u16*)(0x08000000 + 0xE280 + i) = *(u16*)&sDbzLoGUPatch1[i];
+				*(u16*)(uintptr_t)(0x08000000 + 0xE280 + i) = *(u16*)&sDbzLoGUPatch1[i];
 
 			for (int i = 0; i < (int)sizeof(sDbzLoGUPatch2); i += 2)
-				*(u16*)(0x08000000 + 0xE32C + i) = *(u16*)&sDbzLoGUPatch2[i];
+				*(u16*)(uintptr_t)(0x08000000 + 0xE32C + i) = *(u16*)&sDbzLoGUPatch2[i];
 		}
 	} else if (gameCode == 0x50474C41) {
 		//Dragon Ball Z - The Legacy of Goku (Europe)
@@ -0,0 +1,50 @@
+#ifndef DIRSORT_H
+#define DIRSORT_H
+
+#include <gba_types.h>
+#include <stdbool.h>
+
+// Directory entries as the browser lists them
+struct dirent_brief {
+    long off;
+    bool isdir;
+    char nickname[31];
+};
+
+// Shortens a name to fit the browser, keeping its start and its extension
+void dirsort_nickname(char *nickname, const char *name, bool isdir);
+
+// The first four characters of a nickname, case-folded and packed so that
+// comparing keys orders names the way strcasecmp would
+u32 dirsort_key(const char *nickname);
+
+// Compares two entries, by their keys first and by the whole nickname on a tie
+int dirsort_compare(const struct dirent_brief *entries, const u32 *keys, u16 l, u16 r, bool folders_first);
+
+// Sorts an index into entries, instead of moving the entries themselves.
+// scratch must have room for count indices.
+void dirsort_sort(u16 *order, u16 *scratch, u32 count, const struct dirent_brief *entries, const u32 *keys, bool folders_first);
+
+// Where each initial letter starts in a sorted listing. Bucket 0 holds
+// names starting with anything before 'a', the last bucket also takes
+// anything after 'z', so the buckets follow the sort order. A listing with
+// folders first is two sorted runs, each with its own table.
+#define DIRSORT_BUCKETS 27
+
+struct dirsort_index {
+	u32 runs;	// 0 when the listing isn't sorted
+	u16 start[2][DIRSORT_BUCKETS + 1];
+};
+
+// Builds the index for a listing sorted by dirsort_sort
+void dirsort_index_build(struct dirsort_index *index, const u16 *order, u32 count, const struct dirent_brief *entries, const u32 *keys, bool folders_first);
+
+// The first entry of the next or previous initial letter, wrapping around.
+// With index->runs 0 the listing is walked instead.
+s32 dirsort_next_letter(const struct dirsort_index *index, const u16 *order, u32 count, const u32 *keys, s32 pos);
+s32 dirsort_prev_letter(const struct dirsort_index *index, const u16 *order, u32 count, const u32 *keys, s32 pos);
+
+// The first entry whose nickname starts with prefix, ignoring case, or -1
+s32 dirsort_find(const struct dirsort_index *index, const u16 *order, u32 count, const struct dirent_brief *entries, const u32 *keys, const char *prefix);
+
+#endif
@@ -0,0 +1,273 @@
+#include <gba.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "fatmap.h"
+
+#define BYTES_PER_SECTOR 512
+#define DIR_ENTRY_SIZE 32
+
+static const DISC_INTERFACE *disc_io;
+static bool mapped;
+static u32 data_start;
+static u32 sectors_per_cluster;
+static u32 fat_start;
+static u32 fat_bits;
+static u32 root_start;		// FAT12/16, the root directory has its own sectors
+static u32 root_sectors;
+static u32 root_cluster;	// FAT32, the root directory is a cluster chain
+
+// The last FAT or directory sector read
+EWRAM_BSS static u8 sector_buf[BYTES_PER_SECTOR];
+static u32 buffered = ~0;
+
+static u16 read16(const u8 *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static u32 read32(const u8 *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+}
+
+// A volume boot record rather than an MBR, as checked by libfat
+static bool is_boot_sector(const u8 *sector) {
+	return (sector[0] == 0xEB || sector[0] == 0xE9)
+		&& (!memcmp(sector + 0x36, "FAT", 3) || !memcmp(sector + 0x52, "FAT", 3));
+}
+
+bool fatmap_init(const DISC_INTERFACE *disc) {
+	u8 sector[BYTES_PER_SECTOR];
+	u32 partition_start = 0;
+
+	mapped = false;
+	disc_io = disc;
+	buffered = ~0;
+	if (!disc->readSectors(0, 1, sector) || read16(sector + 0x1FE) != 0xAA55)
+		return false;
+
+	// Without a boot sector in sector 0, use the first partition of the MBR
+	if (!is_boot_sector(sector)) {
+		partition_start = read32(sector + 0x1C6);
+		if (!disc->readSectors(partition_start, 1, sector) || !is_boot_sector(sector))
+			return false;
+	}
+
+	if (read16(sector + 0x0B) != BYTES_PER_SECTOR || !sector[0x0D])
+		return false;
+
+	u32 fat_size = read16(sector + 0x16);
+	if (!fat_size)
+		fat_size = read32(sector + 0x24);
+	u32 total_sectors = read16(sector + 0x13);
+	if (!total_sectors)
+		total_sectors = read32(sector + 0x20);
+	root_sectors = (read16(sector + 0x11) * DIR_ENTRY_SIZE + BYTES_PER_SECTOR - 1) / BYTES_PER_SECTOR;
+
+	sectors_per_cluster = sector[0x0D];
+	fat_start = partition_start + read16(sector + 0x0E);
+	root_start = fat_start + sector[0x10] * fat_size;
+	data_start = root_start + root_sectors;
+
+	// The FAT type follows from the cluster count alone
+	u32 clusters = (partition_start + total_sectors - data_start) / sectors_per_cluster;
+	fat_bits = clusters < 4085 ? 12 : clusters < 65525 ? 16 : 32;
+	root_cluster = fat_bits == 32 ? read32(sector + 0x2C) : 0;
+	mapped = true;
+	return true;
+}
+
+static const u8 *read_sector(u32 sector) {
+	if (sector != buffered) {
+		buffered = ~0;
+		if (!disc_io->readSectors(sector, 1, sector_buf))
+			return NULL;
+		buffered = sector;
+	}
+	return sector_buf;
+}
+
+u32 fatmap_clusterSector(u32 cluster) {
+	return data_start + (cluster - 2) * sectors_per_cluster;
+}
+
+u32 fatmap_sectorsPerCluster() {
+	return sectors_per_cluster;
+}
+
+bool fatmap_fileStart(const char *path, u32 *sector, u32 *sectors) {
+	struct stat st;
+
+	// libfat reports a file's first cluster as its inode number
+	if (!mapped || stat(path, &st) || st.st_ino < 2)
+		return false;
+
+	*sector = fatmap_clusterSector(st.st_ino);
+	*sectors = sectors_per_cluster;
+	return true;
+}
+
+u32 fatmap_nextCluster(u32 cluster) {
+	if (!mapped || fat_bits == 12 || cluster < 2)
+		return 0;
+
+	u32 offset = cluster * (fat_bits / 8);
+	const u8 *sector = read_sector(fat_start + offset / BYTES_PER_SECTOR);
+	if (!sector)
+		return 0;
+	u32 next = fat_bits == 16 ? read16(sector + offset % BYTES_PER_SECTOR) : read32(sector + offset % BYTES_PER_SECTOR) & 0x0FFFFFFF;
+	// Bad cluster and end of chain markers
+	if (next >= (fat_bits == 16 ? 0xFFF7 : 0x0FFFFFF7) || next < 2)
+		return 0;
+	return next;
+}
+
+u32 fatmap_extents(u32 cluster, u32 size, struct fatmap_extent *extents, u32 max) {
+	u32 cluster_bytes = sectors_per_cluster * BYTES_PER_SECTOR;
+	u32 clusters = (size + cluster_bytes - 1) / cluster_bytes;
+	u32 len = 0;
+
+	// libfat may have written the FAT since the last look
+	buffered = ~0;
+	while (clusters) {
+		if (cluster < 2)
+			return 0;
+		u32 sector = fatmap_clusterSector(cluster);
+		if (len && extents[len - 1].sector + extents[len - 1].sectors == sector) {
+			extents[len - 1].sectors += sectors_per_cluster;
+		} else {
+			if (len == max)
+				return 0;
+			extents[len].sector = sector;
+			extents[len].sectors = sectors_per_cluster;
+			++len;
+		}
+		if (--clusters)
+			cluster = fatmap_nextCluster(cluster);
+	}
+	return len;
+}
+
+u32 fatmap_countExtents(const char *path) {
+	struct stat st;
+
+	if (!mapped || stat(path, &st) || st.st_ino < 2)
+		return 0;
+	u32 cluster_bytes = sectors_per_cluster * BYTES_PER_SECTOR;
+	u32 clusters = (st.st_size + cluster_bytes - 1) / cluster_bytes;
+	u32 cluster = st.st_ino;
+	u32 count = 1;
+
+	buffered = ~0;
+	while (clusters-- > 1) {
+		u32 next = fatmap_nextCluster(cluster);
+		if (!next)
+			return 0;
+		if (next != cluster + 1)
+			++count;
+		cluster = next;
+	}
+	return count;
+}
+
+static bool find_in_sector(u32 sector, u32 cluster, u32 *offset, u8 *entry, bool *end) {
+	const u8 *data = read_sector(sector);
+	if (!data) {
+		*end = true;
+		return false;
+	}
+	for (u32 i = 0; i < BYTES_PER_SECTOR; i += DIR_ENTRY_SIZE) {
+		const u8 *dirent = data + i;
+		if (!dirent[0]) {
+			*end = true;
+			return false;
+		}
+		// Skip deleted entries, long name parts and volume labels
+		if (dirent[0] == 0xE5 || (dirent[0x0B] & 0x08))
+			continue;
+		u32 first = read16(dirent + 0x1A) | (fat_bits == 32 ? read16(dirent + 0x14) << 16 : 0);
+		if (first == cluster) {
+			*offset = i;
+			memcpy(entry, dirent, DIR_ENTRY_SIZE);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool fatmap_findEntry(u32 dir_cluster, u32 cluster, u32 *sector, u32 *offset, u8 *entry) {
+	bool end = false;
+
+	if (!mapped || cluster < 2)
+		return false;
+	buffered = ~0;
+	if (!dir_cluster && fat_bits != 32) {
+		for (u32 i = 0; i < root_sectors && !end; ++i) {
+			if (find_in_sector(root_start + i, cluster, offset, entry, &end)) {
+				*sector = root_start + i;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	if (!dir_cluster)
+		dir_cluster = root_cluster;
+	for (u32 hops = 0; dir_cluster && !end && hops < 0x10000; ++hops) {
+		u32 first = fatmap_clusterSector(dir_cluster);
+		for (u32 i = 0; i < sectors_per_cluster && !end; ++i) {
+			if (find_in_sector(first + i, cluster, offset, entry, &end)) {
+				*sector = first + i;
+				return true;
+			}
+		}
+		dir_cluster = fatmap_nextCluster(dir_cluster);
+	}
+	return false;
+}
+
+bool fatmap_readEntry(u32 sector, u32 offset, u8 *entry) {
+	if (!mapped || offset > BYTES_PER_SECTOR - DIR_ENTRY_SIZE)
+		return false;
+	// Always from the card, the entry is read to notice changes
+	buffered = ~0;
+	const u8 *data = read_sector(sector);
+	if (!data)
+		return false;
+	memcpy(entry, data + offset, DIR_ENTRY_SIZE);
+	return true;
+}
+
+bool fatmap_mapFile(const char *path, struct fatmap_file *file, struct fatmap_extent *extents, u32 max) {
+	EWRAM_BSS static char dir[PATH_MAX];
+	struct stat st;
+
+	if (stat(path, &st))
+		return false;
+	memset(file, 0, sizeof *file);
+	file->size = st.st_size;
+
+	// libfat reports a file's first cluster as its inode number, the root is 0 here
+	strcpy(dir, path);
+	char *slash = strrchr(dir, '/');
+	u32 dir_cluster = 0;
+	if (slash && slash != dir && slash[-1] != ':') {
+		struct stat dir_st;
+		*slash = '\0';
+		if (stat(dir, &dir_st))
+			return true;
+		dir_cluster = dir_st.st_ino;
+	}
+	if (!fatmap_findEntry(dir_cluster, st.st_ino, &file->entry_sector, &file->entry_offset, file->entry)) {
+		// Can't be checked later, good for this launch only
+		file->entry_sector = 0;
+		return true;
+	}
+	file->extents_len = fatmap_extents(st.st_ino, st.st_size, extents, max);
+	return true;
+}
+
+bool fatmap_unchanged(const struct fatmap_file *file) {
+	u8 entry[DIR_ENTRY_SIZE];
+	return file->entry_sector && fatmap_readEntry(file->entry_sector, file->entry_offset, entry)
+		&& !memcmp(entry, file->entry, sizeof entry);
+}
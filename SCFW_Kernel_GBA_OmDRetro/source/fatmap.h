@@ -0,0 +1,55 @@
+#ifndef FATMAP_H
+#define FATMAP_H
+
+#include <gba.h>
+#include <disc_io.h>
+
+// Finds where files live on the card, so small fixed-size files can be
+// updated with raw sector writes instead of going through libfat, and
+// known files can be read without looking them up.
+
+// A run of consecutive sectors holding part of a file
+struct fatmap_extent {
+	u32 sector;
+	u32 sectors;
+};
+
+// Reads the partition geometry, only needs calling once per mount
+bool fatmap_init(const DISC_INTERFACE *disc);
+
+u32 fatmap_clusterSector(u32 cluster);
+u32 fatmap_sectorsPerCluster();
+
+// Gets the first sector of a file, and how many sectors follow it
+// contiguously without walking the FAT (the rest of its first cluster)
+bool fatmap_fileStart(const char *path, u32 *sector, u32 *sectors);
+
+// The cluster after this one in its chain, 0 at the end or on FAT12
+u32 fatmap_nextCluster(u32 cluster);
+// Maps a file of size bytes starting at cluster into at most max extents.
+// Returns how many it took, 0 if it needs more or the chain is broken.
+u32 fatmap_extents(u32 cluster, u32 size, struct fatmap_extent *extents, u32 max);
+// How many pieces a file lies in on the card, 0 if that can't be told
+u32 fatmap_countExtents(const char *path);
+// Finds the directory entry of the file starting at cluster, in the directory
+// starting at dir_cluster, 0 for the root. entry gets its 32 bytes.
+bool fatmap_findEntry(u32 dir_cluster, u32 cluster, u32 *sector, u32 *offset, u8 *entry);
+// Reads a directory entry back, to see whether the file changed
+bool fatmap_readEntry(u32 sector, u32 offset, u8 *entry);
+
+// A file as it was found, with its directory entry as proof it hasn't
+// changed since: the entry holds its size, first cluster and write time.
+struct fatmap_file {
+	u32 size;
+	u32 entry_sector;		// where the directory entry is, 0 if it wasn't found
+	u32 entry_offset;
+	u8 entry[32];
+	u32 extents_len;		// 0 when the file is too fragmented, it is then read through libfat
+};
+
+// Looks a file up and maps it into at most max extents, false if it doesn't exist
+bool fatmap_mapFile(const char *path, struct fatmap_file *file, struct fatmap_extent *extents, u32 max);
+// Whether the file's directory entry still reads back the same
+bool fatmap_unchanged(const struct fatmap_file *file);
+
+#endif
@@ -0,0 +1,88 @@
+#include <gba.h>
+#include "idle.h"
+
+static struct idle_task tasks[IDLE_TASKS];
+static u32 next_task;
+
+static struct idle_task *find(idle_step step) {
+	for (u32 i = 0; i < IDLE_TASKS; ++i)
+		if (tasks[i].step == step)
+			return &tasks[i];
+	return NULL;
+}
+
+// A free slot, or else one whose job has finished, its numbers dropped
+static struct idle_task *take_slot() {
+	struct idle_task *task = find(NULL);
+	for (u32 i = 0; i < IDLE_TASKS && !task; ++i)
+		if (!tasks[i].active)
+			task = &tasks[i];
+	if (task) {
+		task->steps = 0;
+		task->ticks = 0;
+		task->max = 0;
+	}
+	return task;
+}
+
+static void run_step(struct idle_task *task, u32 deadline) {
+	u32 start = systimer_ticks();
+	task->active = task->step(deadline);
+	u32 elapsed = systimer_ticks() - start;
+	++task->steps;
+	task->ticks += elapsed;
+	if (elapsed > task->max)
+		task->max = elapsed;
+}
+
+bool idle_add(const char *name, idle_step step, u32 budget) {
+	struct idle_task *task = find(step);
+	if (!task)
+		task = take_slot();
+	if (!task)
+		return false;
+	task->name = name;
+	task->step = step;
+	task->budget = budget;
+	task->active = true;
+	return true;
+}
+
+bool idle_busy(idle_step step) {
+	struct idle_task *task = find(step);
+	return task && task->active;
+}
+
+void idle_finish(idle_step step) {
+	struct idle_task *task = find(step);
+	while (task && task->active)
+		run_step(task, systimer_deadline(IDLE_FRAME_TICKS));
+}
+
+void idle_run(u32 ticks) {
+	u32 frame_end = systimer_deadline(ticks);
+	u16 keys = REG_KEYINPUT;
+
+	// A step for each task, the first one changes every frame so they all get time
+	for (u32 n = 0; n < IDLE_TASKS; ++n) {
+		struct idle_task *task = &tasks[(next_task + n) % IDLE_TASKS];
+		if (!task->active)
+			continue;
+		if (systimer_expired(frame_end) || REG_KEYINPUT != keys)
+			break;
+		u32 left = frame_end - systimer_ticks();
+		run_step(task, systimer_deadline(task->budget && task->budget < left ? task->budget : left));
+	}
+	next_task = (next_task + 1) % IDLE_TASKS;
+}
+
+void idle_print(FILE *out) {
+	fiprintf(out, "%-12s%6s%6s%6s\n", "task", "steps", "ms", "max");
+	for (u32 i = 0; i < IDLE_TASKS; ++i) {
+		const struct idle_task *task = &tasks[i];
+		if (!task->step)
+			continue;
+		fiprintf(out, "%-11.11s%c%6lu%6lu%6lu\n", task->name, task->active ? '*' : ' ', task->steps,
+		         systimer_to_ms(task->ticks), systimer_to_ms(task->max));
+	}
+}
@@ -0,0 +1,135 @@
+#include <gba.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include "launchlog.h"
+#include "fatmap.h"
+#include "my_io_scsd.h"
+#include "systimer.h"
+
+#define BYTES_PER_SECTOR 512
+#define LAUNCHLOG_SIZE (LAUNCHLOG_RECORDS * sizeof(struct launchlog_record))
+#define RECORDS_PER_SECTOR (BYTES_PER_SECTOR / sizeof(struct launchlog_record))
+
+// Compared case insensitively with what follows the last dot of the path,
+// 0 when nothing matches. A record keeps the index, new systems go last.
+const char *const launchlog_systems[LAUNCHLOG_SYSTEMS + 1] = {
+	"other", "gba", "gbc", "gb", "wsc", "ws", "pc2", "fds", "nsf", "nes",
+	"pce", "sms", "gg", "sg", "sv", "ngp", "ngc", "mpac", "mpa", "col", NULL
+};
+
+_Static_assert(sizeof(struct launchlog_record) == 32, "launch log records must stay 32 bytes");
+
+struct launchlog_totals launchlog_totals;
+
+static struct launchlog_record current;
+static SCSD_STATS stats_at_begin;
+
+static u32 fnv1a(const char *s) {
+	u32 hash = 0x811C9DC5;
+	while (*s) {
+		hash ^= (u8)*s++;
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
+u8 launchlog_system(const char *path) {
+	const char *ext = strrchr(path, '.');
+	if (ext) {
+		for (int i = 1; launchlog_systems[i]; ++i)
+			if (!strcasecmp(ext + 1, launchlog_systems[i]))
+				return i;
+	}
+	return 0;
+}
+
+static u16 clamp16(u32 n) {
+	return n > 0xFFFF ? 0xFFFF : n;
+}
+
+void launchlog_begin(const char *path) {
+	memset(&launchlog_totals, 0, sizeof launchlog_totals);
+	memset(&current, 0, sizeof current);
+	current.path_hash = fnv1a(path);
+	current.system = launchlog_system(path);
+	stats_at_begin = _SCSD_stats;
+}
+
+// Creates the log at its full size, so it never has to grow afterwards
+static bool create_log() {
+	FILE *log = fopen(LAUNCHLOG_PATH, "wb");
+	if (!log)
+		return false;
+	static const struct launchlog_record empty;
+	bool ok = true;
+	for (int i = 0; i < LAUNCHLOG_RECORDS && ok; ++i)
+		ok = fwrite(&empty, sizeof empty, 1, log) == 1;
+	fclose(log);
+	return ok;
+}
+
+bool launchlog_commit() {
+	EWRAM_BSS static struct launchlog_record ring[LAUNCHLOG_RECORDS];
+	struct stat st;
+	u32 sector, sectors;
+
+	current.bytes_loaded = launchlog_totals.bytes_loaded;
+	current.load_ms = systimer_to_ms(launchlog_totals.load_ticks);
+	current.patch_ms = clamp16(systimer_to_ms(launchlog_totals.patch_ticks));
+	current.save_bytes = launchlog_totals.save_bytes;
+	current.save_ms = clamp16(systimer_to_ms(launchlog_totals.save_ticks));
+	current.save_type = launchlog_totals.save_type;
+	current.timeouts = clamp16(_SCSD_stats.timeouts - stats_at_begin.timeouts);
+	current.crc_errors = clamp16(_SCSD_stats.crcErrors - stats_at_begin.crcErrors);
+	u32 retries = _SCSD_stats.retries - stats_at_begin.retries;
+	current.retries = retries > 0xFF ? 0xFF : retries;
+
+	bool created = false;
+	if (stat(LAUNCHLOG_PATH, &st) || st.st_size != LAUNCHLOG_SIZE) {
+		if (!create_log())
+			return false;
+		created = true;
+	}
+
+	// Only a log that sits in one cluster can be written to directly. Nothing
+	// else reads it through libfat, so libfat's cache only holds its sectors
+	// when it was just created, and that first record goes through stdio.
+	bool raw = !created && fatmap_fileStart(LAUNCHLOG_PATH, &sector, &sectors)
+		&& sectors * BYTES_PER_SECTOR >= LAUNCHLOG_SIZE;
+
+	FILE *log = NULL;
+	if (raw) {
+		raw = _my_io_scsd.readSectors(sector, LAUNCHLOG_SIZE / BYTES_PER_SECTOR, ring);
+	}
+	if (!raw) {
+		log = fopen(LAUNCHLOG_PATH, "r+b");
+		if (!log || fread(ring, sizeof ring, 1, log) != 1) {
+			if (log)
+				fclose(log);
+			return false;
+		}
+	}
+
+	// The slot after the newest record holds the oldest one
+	u32 newest = 0, slot = 0;
+	for (int i = 0; i < LAUNCHLOG_RECORDS; ++i) {
+		if (ring[i].seq > newest) {
+			newest = ring[i].seq;
+			slot = (i + 1) % LAUNCHLOG_RECORDS;
+		}
+	}
+	current.seq = newest + 1;
+	ring[slot] = current;
+
+	if (raw) {
+		u32 first = slot / RECORDS_PER_SECTOR;
+		return _my_io_scsd.writeSectors(sector + first, 1, &ring[first * RECORDS_PER_SECTOR]);
+	}
+
+	fseek(log, slot * sizeof current, SEEK_SET);
+	bool ok = fwrite(&current, sizeof current, 1, log) == 1;
+	fclose(log);
+	return ok;
+}
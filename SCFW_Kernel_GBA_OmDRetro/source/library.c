@@ -0,0 +1,284 @@
+#include <gba.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "library.h"
+
+// An array that grows as the card is walked
+struct growing {
+	void *data;
+	u32 len;
+	u32 cap;
+	u32 size;
+};
+
+// A whole index held in memory
+struct index {
+	struct library_header header;
+	struct library_dir *dirs;
+	struct library_game *games;
+	char *pool;
+};
+
+static FILE *library_file;
+
+static void *grow(struct growing *array, u32 count) {
+	if (array->len + count > array->cap) {
+		u32 cap = array->cap ? array->cap : 64;
+		while (cap < array->len + count)
+			cap *= 2;
+		void *data = realloc(array->data, cap * array->size);
+		if (!data)
+			return NULL;
+		array->data = data;
+		array->cap = cap;
+	}
+	void *at = (u8*) array->data + array->len * array->size;
+	array->len += count;
+	return at;
+}
+
+static bool pool_add(struct growing *pool, const char *text, u32 *offset) {
+	u32 len = strlen(text) + 1;
+	*offset = pool->len;
+	char *at = grow(pool, len);
+	if (!at)
+		return false;
+	memcpy(at, text, len);
+	return true;
+}
+
+static bool add_dir(struct growing *dirs, struct growing *pool, const char *path, u16 parent) {
+	u32 offset;
+	if (dirs->len >= LIBRARY_NO_DIR || !pool_add(pool, path, &offset))
+		return false;
+	struct library_dir *dir = grow(dirs, 1);
+	if (!dir)
+		return false;
+	*dir = (struct library_dir){ .path = offset, .parent = parent };
+	return true;
+}
+
+static bool add_game(struct growing *games, struct growing *pool, const char *name, u32 size, u16 dir, u8 system) {
+	u32 offset;
+	if (!pool_add(pool, name, &offset))
+		return false;
+	struct library_game *game = grow(games, 1);
+	if (!game)
+		return false;
+	*game = (struct library_game){ .name = offset, .size = size, .dir = dir, .system = system };
+	return true;
+}
+
+static void free_index(struct index *index) {
+	free(index->dirs);
+	free(index->games);
+	free(index->pool);
+	memset(index, 0, sizeof *index);
+}
+
+static bool load_index(struct index *index) {
+	FILE *file = fopen(LIBRARY_PATH, "rb");
+	if (!file)
+		return false;
+
+	struct library_header *header = &index->header;
+	bool ok = fread(header, sizeof *header, 1, file) == 1 && header->magic == LIBRARY_MAGIC;
+	if (ok) {
+		index->dirs = malloc(header->dirs * sizeof *index->dirs);
+		index->games = malloc(header->games * sizeof *index->games);
+		index->pool = malloc(header->pool_size);
+		ok = (index->dirs || !header->dirs) && (index->games || !header->games) && (index->pool || !header->pool_size)
+			&& fread(index->dirs, sizeof *index->dirs, header->dirs, file) == header->dirs
+			&& fread(index->games, sizeof *index->games, header->games, file) == header->games
+			&& fread(index->pool, 1, header->pool_size, file) == header->pool_size;
+	}
+	fclose(file);
+	if (!ok)
+		free_index(index);
+	return ok;
+}
+
+static s32 find_dir(const struct index *index, const char *path) {
+	for (u32 i = 0; i < index->header.dirs; ++i)
+		if (!strcmp(index->pool + index->dirs[i].path, path))
+			return i;
+	return -1;
+}
+
+static void join(char *out, const char *dir, const char *name) {
+	u32 len = strlen(dir);
+	snprintf(out, PATH_MAX, "%s%s%s", dir, len && dir[len - 1] == '/' ? "" : "/", name);
+}
+
+// Takes an unchanged directory's games and subdirectories from the old index
+static bool reuse_dir(const struct index *old, u16 known, u16 dir, struct growing *dirs, struct growing *games, struct growing *pool) {
+	for (u32 i = 0; i < old->header.games; ++i) {
+		const struct library_game *game = &old->games[i];
+		if (game->dir == known && !add_game(games, pool, old->pool + game->name, game->size, dir, game->system))
+			return false;
+	}
+	for (u32 i = 0; i < old->header.dirs; ++i)
+		if (old->dirs[i].parent == known && !add_dir(dirs, pool, old->pool + old->dirs[i].path, dir))
+			return false;
+	return true;
+}
+
+static bool read_dir(const char *path, u16 dir, bool (*accept)(struct dirent*), struct growing *dirs, struct growing *games, struct growing *pool) {
+	DIR *handle = opendir(path);
+	if (!handle)
+		return true;
+
+	bool ok = true;
+	char child[PATH_MAX];
+	struct dirent *dirent;
+	while (ok && (dirent = readdir(handle))) {
+		// Also skips the metadata files some computers leave behind
+		if (dirent->d_name[0] == '.')
+			continue;
+		join(child, path, dirent->d_name);
+		if (dirent->d_type == DT_DIR) {
+			ok = add_dir(dirs, pool, child, dir);
+		} else if (accept(dirent)) {
+			struct stat st;
+			u32 size = stat(child, &st) ? 0 : st.st_size;
+			ok = add_game(games, pool, dirent->d_name, size, dir, launchlog_system(dirent->d_name));
+		}
+	}
+	closedir(handle);
+	return ok;
+}
+
+static const char *sort_pool;
+
+static int compare_games(const void *lv, const void *rv) {
+	const struct library_game *l = lv;
+	const struct library_game *r = rv;
+	if (l->system != r->system)
+		return l->system < r->system ? -1 : 1;
+	return strcasecmp(sort_pool + l->name, sort_pool + r->name);
+}
+
+static bool write_index(struct library_header *header, struct growing *dirs, struct growing *games, struct growing *pool) {
+	struct library_game *list = games->data;
+
+	sort_pool = pool->data;
+	qsort(list, games->len, sizeof *list, compare_games);
+
+	memset(header, 0, sizeof *header);
+	header->magic = LIBRARY_MAGIC;
+	header->dirs = dirs->len;
+	header->games = games->len;
+	header->pool_size = pool->len;
+	u32 n = 0;
+	for (u32 system = 0; system <= LAUNCHLOG_SYSTEMS; ++system) {
+		header->first[system] = n;
+		while (n < games->len && list[n].system == system)
+			++n;
+	}
+
+	FILE *file = fopen(LIBRARY_PATH, "wb");
+	if (!file)
+		return false;
+	bool ok = fwrite(header, sizeof *header, 1, file) == 1
+		&& fwrite(dirs->data, dirs->size, dirs->len, file) == dirs->len
+		&& fwrite(games->data, games->size, games->len, file) == games->len
+		&& fwrite(pool->data, 1, pool->len, file) == pool->len;
+	fclose(file);
+	return ok;
+}
+
+s32 library_refresh(bool (*accept)(struct dirent*), bool full) {
+	struct index old = { .header.dirs = 0 };
+	if (!full)
+		load_index(&old);
+
+	struct growing dirs = { .size = sizeof(struct library_dir) };
+	struct growing games = { .size = sizeof(struct library_game) };
+	struct growing pool = { .size = 1 };
+	char path[PATH_MAX];
+
+	// The directory list is also the queue of directories left to visit
+	bool ok = add_dir(&dirs, &pool, "fat:/", LIBRARY_NO_DIR);
+	for (u32 i = 0; ok && i < dirs.len; ++i) {
+		struct library_dir *dir = &((struct library_dir*) dirs.data)[i];
+		strcpy(path, (char*) pool.data + dir->path);
+		struct stat st;
+		u32 mtime = stat(path, &st) ? 0 : st.st_mtime;
+		dir->mtime = mtime;
+
+		s32 known = find_dir(&old, path);
+		if (known >= 0 && mtime && old.dirs[known].mtime == mtime)
+			ok = reuse_dir(&old, known, i, &dirs, &games, &pool);
+		else
+			ok = read_dir(path, i, accept, &dirs, &games, &pool);
+	}
+	free_index(&old);
+
+	struct library_header header;
+	if (ok)
+		ok = write_index(&header, &dirs, &games, &pool);
+	free(dirs.data);
+	free(games.data);
+	free(pool.data);
+	return ok ? (s32) header.games : -1;
+}
+
+bool library_open(struct library_header *header) {
+	library_close();
+	library_file = fopen(LIBRARY_PATH, "rb");
+	if (!library_file)
+		return false;
+	if (fread(header, sizeof *header, 1, library_file) != 1 || header->magic != LIBRARY_MAGIC) {
+		library_close();
+		return false;
+	}
+	return true;
+}
+
+void library_close() {
+	if (library_file)
+		fclose(library_file);
+	library_file = NULL;
+}
+
+static u32 pool_start(const struct library_header *header) {
+	return sizeof *header + header->dirs * sizeof(struct library_dir) + header->games * sizeof(struct library_game);
+}
+
+static bool read_string(u32 offset, char *text, u32 size) {
+	if (fseek(library_file, offset, SEEK_SET))
+		return false;
+	u32 len = fread(text, 1, size - 1, library_file);
+	text[len] = '\0';
+	return len != 0;
+}
+
+bool library_game(const struct library_header *header, u32 system, u32 n, struct library_game *game, char *name, u32 name_size) {
+	u32 index = header->first[system] + n;
+	if (!library_file || index >= header->first[system + 1])
+		return false;
+	u32 offset = pool_start(header) - (header->games - index) * sizeof *game;
+	if (fseek(library_file, offset, SEEK_SET) || fread(game, sizeof *game, 1, library_file) != 1)
+		return false;
+	return !name || read_string(pool_start(header) + game->name, name, name_size);
+}
+
+bool library_path(const struct library_header *header, const struct library_game *game, char *path) {
+	struct library_dir dir;
+	char name[256];
+
+	if (!library_file || game->dir >= header->dirs)
+		return false;
+	if (fseek(library_file, sizeof *header + game->dir * sizeof dir, SEEK_SET) || fread(&dir, sizeof dir, 1, library_file) != 1)
+		return false;
+	if (!read_string(pool_start(header) + dir.path, path, PATH_MAX)
+	    || !read_string(pool_start(header) + game->name, name, sizeof name))
+		return false;
+	u32 len = strlen(path);
+	snprintf(path + len, PATH_MAX - len, "%s%s", len && path[len - 1] == '/' ? "" : "/", name);
+	return true;
+}
@@ -0,0 +1,53 @@
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <gba.h>
+#include <dirent.h>
+#include "launchlog.h"
+
+// Every game on the card in one file, grouped by system and sorted by name,
+// so they can be listed without reading any directories. The card is walked
+// once, later refreshes only read the directories whose write time changed.
+//
+// Layout: struct library_header, the directories, the games, then a pool of
+// NUL-terminated directory paths and file names.
+#define LIBRARY_PATH "/scfw/library.idx"
+#define LIBRARY_MAGIC 0x3142494C	// "LIB1"
+
+struct library_header {
+	u32 magic;
+	u32 dirs;
+	u32 games;
+	u32 pool_size;
+	u32 first[LAUNCHLOG_SYSTEMS + 1];	// each system's first game, the last is the total
+};
+
+struct library_dir {
+	u32 path;		// offset in the pool
+	u32 mtime;		// 0 if the card doesn't say, the directory is then always read
+	u16 parent;		// LIBRARY_NO_DIR for the root
+	u16 reserved;
+};
+#define LIBRARY_NO_DIR 0xFFFF
+
+struct library_game {
+	u32 name;		// offset in the pool
+	u32 size;
+	u16 dir;
+	u8 system;		// index into launchlog_systems
+	u8 reserved;
+};
+
+// Brings the index up to date, or rebuilds it from scratch with full set.
+// accept picks the files that are games. Returns how many there are, or -1.
+s32 library_refresh(bool (*accept)(struct dirent*), bool full);
+
+// Opens the index for the calls below
+bool library_open(struct library_header *header);
+void library_close();
+// Reads a system's n-th game, and its file name if name isn't NULL
+bool library_game(const struct library_header *header, u32 system, u32 n, struct library_game *game, char *name, u32 name_size);
+// Builds the full path of a game, path must hold PATH_MAX
+bool library_path(const struct library_header *header, const struct library_game *game, char *path);
+
+#endif
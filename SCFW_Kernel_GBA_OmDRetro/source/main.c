@@ -3,16 +3,34 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <limits.h>
 #include <dirent.h>
+#include <sys/stat.h>
 #include <errno.h>
 #include <time.h> //For PseudoRTC
 #include "Save.h"
 #include "WhiteScreenPatch.h"
+#include "SoftResetPatch.h"
 
 #include "my_io_scsd.h"
-#include "irq_hook.h"
+#include "systimer.h"
+#include "iostats.h"
+#include "profile.h"
+#include "fatmap.h"
+#include "launchlog.h"
+#include "progress.h"
+#include "textmap.h"
+#include "dirsort.h"
+#include "library.h"
+#include "asset.h"
+#include "state.h"
+#include "recent.h"
+#include "idle.h"
+#include "bundle.h"
+#include "romhead.h"
+#include "prebuilt.h"
 
 char *stpcpy(char*, char*);
 int strcasecmp(char*, char*);
@@ -49,12 +67,6 @@ bool filter_selectable(struct dirent *dirent);
 
 bool (*filters[FILTER_LEN])(struct dirent*) = { &filter_all, &filter_selectable, &filter_game };
 
-struct dirent_brief {
-    long off;
-    bool isdir;
-    char nickname[31];
-};
-
 enum
 {
 	SORT_NONE,
@@ -63,22 +75,6 @@ enum
 	SORT_LEN
 };
 
-int sort_nickname(void const *l, void const *r) {
-	return strncasecmp(((struct dirent_brief*) l)->nickname, ((struct dirent_brief*) r)->nickname, 31);
-}
-
-int sort_folder_nickname(void const *lv, void const *rv) {
-	struct dirent_brief *l = lv;
-	struct dirent_brief *r = rv;
-	if (l->isdir && !r->isdir)
-		return -1;
-	else if (!l->isdir && r->isdir)
-		return 1;
-	else
-		return sort_nickname(l, r);
-}
-
-int (*sorts[SORT_LEN])(void const*, void const*) = { NULL, &sort_nickname, &sort_folder_nickname };
 
 struct settings {
 	int autosave;
@@ -96,6 +92,13 @@ struct settings {
 	int DrSMS_prio;
 	int CoG_prio;
 	int txtmode_s;
+	int verify_reads;
+	int recent_boot;
+	int autoboot;
+	int deferred_save;
+	int prefetch;
+	int bundle_cache;
+	int prebuilt;
 };
 struct settings settings = {
 	.autosave = 1,
@@ -112,91 +115,14 @@ struct settings settings = {
 	.bwsc_bios = 0,
 	.DrSMS_prio = 0,
 	.CoG_prio = 0,
-	.txtmode_s = 0
-};
-
-struct bwsc_h{
-	u32 id; //BWS",0x1A
-	u32 filesize;
-	u32 flags;			// Bit 1 = PCV2, Bit 2 = WSC, Bit 3 = SwanCrystal.
-	u32 undef;
-	u32 bios;				// Bit 0 = Bios,
-	u32 res0, res1, res2;
-	char name[32];
-};
-
-struct CoG_h {
-	u16 r_size;
-	char pad[9];
-}; //total of 11 bytes
-
-struct hvca_h{
-	long id; //long magic equivalent to HEX 70 41 17 04
-	char filename[32]; 
-	char ext[4];
-	long filesize;
-};
-
-struct mpa2_h{
-    u32 TotalH_size;
-    u32 h_size;
-    char songtitle[40];
-    u32 term0,term1;
-};
-
-struct ngp_h{
-	u32 id; //NGP,0x1A
-	u32 filesize;
-	u32 flags; // flags + branch hacks + reserved
-	u32 follow;
-	u32 bios, res0, res1, res2;	// bit 0 = bios file.
-	char name[32];
-};
-
-struct pcea_h {
-	char name[32];
-	u32 filesize;
-	u32 flags;
-	u32 follow;
-	u32 f_address;
-	u32 id;
-	char unk[12];
-};
-
-struct pnes_h {
-	char name[32];
-	u32 filesize;
-	u32 flags;
-	u32 follow;
-	u32 reserved;
-};
-
-struct drsms_h {
-	u8 id; //ROM #. ROM 0 is the emulator itself so ROMs actually start at 1
-	char pad0[5]; //pad 5 bytes of data
-	u8 flags; //Indicate if USA/JAP ROM(bit 2) or EUR ROM(bit 3) or Game Gear Japan ROM (bit 1)
-	char pad1[5]; //pad 5 bytes for SMS. If Game Gear ROM, assign pad1[1]= 0x01 ~ means game gear mode
-	char name[28];
-};
-
-struct smsa_h {
-	u32 id;
-	u32 filesize;
-	u16 flags;
-	u16 hacks;
-	u32 follow;
-	u32 B_flag, res0, res1, res2; //BIOS flags + 15 bytes of reserved data
-	char name[32];
-};
-
-struct wsv_h{
-	u32 id; //WSV,0x1A
-	u32 filesize;
-	u32 flags;
-	u32 follow;
-	u32 bios; // bit 0 = bios file.
-	u32 res[3];
-	char name[32];
+	.txtmode_s = 0,
+	.verify_reads = 0,
+	.recent_boot = 1,
+	.autoboot = 0,
+	.deferred_save = 1,
+	.prefetch = 1,
+	.bundle_cache = 1,
+	.prebuilt = 1
 };
 
 union paging_index {
@@ -332,21 +258,25 @@ IWRAM_DATA u8 filebuf[0x4000];
 
 u32 pressed;
 bool savingAllowed = true;
+// Set when launching a recent game, the SRAM patch then skips save_findTag
+u16 knownSaveType = RECENT_SAVE_UNKNOWN;
+// Set when the kernel went straight into the last game without showing the menu
+bool autobooting;
+
+_Static_assert(sizeof(struct settings) <= STATE_SETTINGS_MAX, "settings must fit the state record");
+
+void storeSettings() {
+	memcpy(kernel_state.settings, &settings, sizeof settings);
+	kernel_state.settings_size = sizeof settings;
+}
 
+// Also stores the save path FlashROM noted, both go out in the same write
 void setLastPlayed(char *path) {
-	/*
-	FILE *lastPlayed = fopen("/scfw/lastplayed.txt", "rb");
-	char old_path[PATH_MAX];
-	fread(old_path, PATH_MAX, 1, lastPlayed);
-	if (strcmp(path, old_path)) {
-		freopen("/scfw/lastplayed.txt", "wb", lastPlayed);
-		fwrite(path, strlen(path), 1, lastPlayed);
-	}
-	fclose(lastPlayed);
-	*/
-	FILE *lastPlayed = fopen("/scfw/lastplayed.txt", "w+b");
-	fwrite(path, strlen(path), 1, lastPlayed);
-	fclose(lastPlayed);
+	if (strlen(path) < sizeof kernel_state.last_played)
+		strcpy(kernel_state.last_played, path);
+	else
+		kernel_state.last_played[0] = '\0';
+	state_commit();
 }
 
 void loadSram(char *path) {
@@ -355,6 +285,7 @@ void loadSram(char *path) {
 	if (sav) {
 		iprintf("Loading SRAM:\n\n");
 		total_bytes = 0,bytes = 0;
+		progress_begin(0x10000);
 		do {
 			bytes = fread(filebuf, 1, sizeof filebuf, sav);
 			sc_mode(SC_RAM_RO);
@@ -366,92 +297,96 @@ void loadSram(char *path) {
 			}
 			sc_mode(SC_MEDIA);
 			total_bytes += bytes;
-			iprintf("\x1b[1A\x1b[K0x%x/0x10000\n", total_bytes);
+			launchlog_totals.save_bytes += bytes;
+			progress_set(total_bytes);
 		} while (bytes);
+		progress_end();
+		iprintf("\x1b[1A\x1b[K0x%x/0x10000\n", total_bytes);
 	fclose(sav);
 	} else {
 		iprintf("Save file does not exist.\n");
 	}
 }
 
+// A save already at full size is written over where it lies, so one laid
+// out in a single run by tools/scdefrag stays that way
+static FILE *open_save(const char *path) {
+	struct stat st;
+	if (!stat(path, &st) && st.st_size == 0x10000) {
+		FILE *sav = fopen(path, "r+b");
+		if (sav)
+			return sav;
+	}
+	return fopen(path, "w+b");
+}
+
 void saveSram(char *path) {
 	sc_mode(SC_MEDIA);
 	iprintf("Saving SRAM to %s\n\n", path);
-	FILE *sav = fopen(path, "w+b");
+	FILE *sav = open_save(path);
 	if (sav) {
+		progress_begin(0x10000);
 		for (int i = 0; i < 0x00010000; i += sizeof filebuf) {
 			sc_mode(SC_RAM_RO);
 			for (int j = 0; j < sizeof filebuf; ++j)
 				filebuf[j] = GBA_SRAM[i + j];
 			sc_mode(SC_MEDIA);
 			fwrite(filebuf, sizeof filebuf, 1, sav);
-			iprintf("\x1b[1A\x1b[K0x%x/0x10000\n", i);
+			progress_set(i + sizeof filebuf);
 		}
+		progress_end();
+		iprintf("\x1b[1A\x1b[K0x%x/0x10000\n", 0x10000);
 		fclose(sav);
 	}
 }
 
-bool is_empty(s32 *buf, int size) {
-	bool ones = false;
-	bool zeroes = false;
-	for (int i = 0; i < size; ++i) {
-		if (buf[i] == 0 && !ones) {
-			zeroes = true;
-		}
-		else if (buf[i] == -1 && !zeroes) {
-			ones = true;
-		}
-		else {
-			return false;
+// The boot autosave in deferred mode: SRAM is copied aside at once, and the
+// copy goes to the card a chunk at a time as an idle task
+#define AUTOSAVE_CHUNK 0x800
+#define AUTOSAVE_TICKS_PER_FRAME SYSTIMER_MS(4)
+
+EWRAM_BSS static u8 sram_copy[0x10000];
+static FILE *autosave_file;
+static u32 autosave_written;
+
+// Writes chunks until deadline, at least one
+static bool autosave_step(u32 deadline) {
+	while (autosave_file) {
+		fwrite(sram_copy + autosave_written, AUTOSAVE_CHUNK, 1, autosave_file);
+		autosave_written += AUTOSAVE_CHUNK;
+		if (autosave_written == sizeof sram_copy) {
+			fclose(autosave_file);
+			autosave_file = NULL;
+			// Up to here a reset would autosave again from SRAM
+			kernel_state.last_saved[0] = '\0';
+			state_commit();
+		} else if (systimer_expired(deadline)) {
+			break;
 		}
 	}
-	return true;
+	return autosave_file;
 }
 
-void resetPatch(u32 romsize) {
-	iprintf("Soft reset patching...\n");
-	sc_mode(SC_RAM_RW);
-	
-	u32 original_branch = *GBA_ROM;
-	u32 original_entrypoint = ((original_branch & 0x00ffffff) << 2) + 0x08000008;
-	u32 patched_entrypoint = 0x09ffff00 - irq_hook_bin_len - 4;
-	if (patched_entrypoint < 0x08000000 + romsize)
-		while (patched_entrypoint > 0x080000c0) {
-			if (is_empty((s32*) patched_entrypoint, irq_hook_bin_len + 4))
-				break;
-			patched_entrypoint -= 4;
-		}
-	if (patched_entrypoint <= 0x080000c0) {
-		iprintf("Could not soft reset patch\n");
-		return;
-	}
-	u32 patched_branch = 0xea000000 | ((patched_entrypoint - 0x08000008) >> 2);
-	
-	int ctr = 0;
-	for (int i = 0; i < romsize >> 2; ++i)
-		if (GBA_ROM[i] == 0x03007ffc) {
-			GBA_ROM[i] = 0x03fffff4;
-			++ctr;
-		}
-	if (!ctr) {
-		iprintf("Could not soft reset patch!\n");
+void autosave_begin(char *path) {
+	sc_mode(SC_RAM_RO);
+	for (int i = 0; i < sizeof sram_copy; ++i)
+		sram_copy[i] = GBA_SRAM[i];
+	sc_mode(SC_MEDIA);
+	autosave_file = open_save(path);
+	autosave_written = 0;
+	if (autosave_file)
+		idle_add("autosave", autosave_step, AUTOSAVE_TICKS_PER_FRAME);
+}
+
+// A launch replaces SRAM's contents and leaves the kernel, so it waits for the autosave
+void autosave_finish() {
+	if (!idle_busy(autosave_step))
 		return;
-	}
-	*GBA_ROM = patched_branch; 
-	int i;
-	for (i = 0; i < irq_hook_bin_len >> 2; ++i)
-		i[(u32*) patched_entrypoint] = i[(u32*) irq_hook_bin];
-	i[(u32*) patched_entrypoint] = original_entrypoint;
-	iprintf("Patched!\n");
-}
-
-u32 u32conv(const char* text) {
-    u32 result = 0;
-    for (int i = 0; i < 3; ++i) {
-        result <<= 8; // Shift left by 8 bits
-        result |= (u32)text[i]; // OR with ASCII value
-    }
-    return result;
+	iprintf("Finishing autosave\n\n");
+	progress_begin(sizeof sram_copy);
+	progress_set(autosave_written);
+	idle_finish(autosave_step);
+	progress_end();
 }
 
 void u_prompt(char *i)
@@ -560,11 +495,112 @@ int ext_length(char *path){
     return strlen(ext);
 }
 
+// Loads the game's save, and notes where the next boot should write it back
+void prepareSave(char *path, u32 pathlen) {
+	if (!settings.autosave)
+		return;
+	u32 save_start = systimer_ticks();
+	char savname[PATH_MAX];
+	strcpy(savname, path);
+	strcpy(savname + pathlen - ext_length(path), ".sav");
+	loadSram(savname);
+
+	if (strlen(savname) < sizeof kernel_state.last_saved)
+		strcpy(kernel_state.last_saved, savname);
+	else
+		iprintf("Save path too long to autosave\n");
+	launchlog_totals.save_ticks += systimer_ticks() - save_start;
+}
+
+// Writes the start of SDRAM out to a file
+static bool sdram_write(FILE *file, u32 size) {
+	bool ok = true;
+	for (u32 at = 0; ok && at < size; at += sizeof filebuf) {
+		u32 len = size - at < sizeof filebuf ? size - at : sizeof filebuf;
+		sc_mode(SC_RAM_RO);
+		DMA_Copy(3, &GBA_ROM[at >> 2], filebuf, DMA32 | (len + 3) >> 2);
+		sc_mode(SC_MEDIA);
+		ok = fwrite(filebuf, 1, len, file) == len;
+	}
+	return ok;
+}
+
+#ifdef SCFW_DUMP_IMAGE
+// Keeps the patched image as <game>.dump, for scpack -c to compare with
+static void DumpImage(char *path) {
+	char dump_path[PATH_MAX];
+	if (strlen(path) + sizeof ".dump" > sizeof dump_path)
+		return;
+	strcpy(dump_path, path);
+	strcat(dump_path, ".dump");
+	FILE *file = fopen(dump_path, "wb");
+	if (!file)
+		return;
+	iprintf("Dumping image...\n");
+	sdram_write(file, romSize);
+	fclose(file);
+}
+#endif
+
+// Loads the save and patches the game, once all of it is in SDRAM
+void FinishROM(char *path, u32 pathlen) {
+	prepareSave(path, pathlen);
+
+	u32 patch_start = systimer_ticks();
+	if (settings.waitstate_patch) {
+		iprintf("Applying waitstate patches...\n");
+		sc_mode(SC_RAM_RW);
+		PROFILE_BEGIN(PROFILE_WHITESCREEN_PATCH);
+		patchGeneralWhiteScreen();
+		PROFILE_END(PROFILE_WHITESCREEN_PATCH);
+		PROFILE_BEGIN(PROFILE_SPECIFIC_GAME_PATCH);
+		patchSpecificGame();
+		PROFILE_END(PROFILE_SPECIFIC_GAME_PATCH);
+		iprintf("Waitstate patch done!\n");
+	}
+
+	if (settings.sram_patch) {
+		iprintf("Applying SRAM patch...\n");
+		sc_mode(SC_RAM_RW);
+		PROFILE_BEGIN(PROFILE_SAVE_FIND_TAG);
+		// A recent game's save type is known, the ROM needn't be searched for it
+		const struct save_type* saveType = !savingAllowed ? NULL
+			: knownSaveType != RECENT_SAVE_UNKNOWN ? save_findType(knownSaveType) : save_findTag();
+		PROFILE_END(PROFILE_SAVE_FIND_TAG);
+		launchlog_totals.save_type = saveType ? saveType->type : SAVE_TYPE_NONE;
+		if (saveType != NULL && saveType->patchFunc != NULL){
+			PROFILE_BEGIN(PROFILE_SAVE_PATCH);
+			bool done = saveType->patchFunc(saveType);
+			PROFILE_END(PROFILE_SAVE_PATCH);
+			if(!done)
+				printf("Save Type Patch Error\n");
+		} else {
+			printf("No need to patch\n");
+		}
+	}
+	
+	if (settings.soft_reset_patch) {
+		PROFILE_BEGIN(PROFILE_RESET_PATCH);
+		sc_mode(SC_RAM_RW);
+		resetPatch(romSize);
+		PROFILE_END(PROFILE_RESET_PATCH);
+	}
+	launchlog_totals.patch_ticks += systimer_ticks() - patch_start;
+#ifdef SCFW_DUMP_IMAGE
+	DumpImage(path);
+#endif
+}
+
 void FlashROM(char *path, u32 pathlen, FILE *rom, u32 romsize, bool F_EOL){
 	//Placeholder for now
 	//u32 total_bytes = 0, bytes = 0;
+	PROFILE_BEGIN(PROFILE_FLASHROM);
+	u32 load_start = systimer_ticks();
+	_SCSD_verifyReads = settings.verify_reads;
+	progress_begin(romsize);
 	do {
 		bytes = fread(filebuf, 1, sizeof filebuf, rom);
+		launchlog_totals.bytes_loaded += bytes;
 		sc_mode(SC_RAM_RW);
 		DMA_Copy(3, filebuf, &GBA_ROM[total_bytes >> 2], DMA32 | bytes >> 2);
 		/*
@@ -577,46 +613,190 @@ void FlashROM(char *path, u32 pathlen, FILE *rom, u32 romsize, bool F_EOL){
 		*/
 		sc_mode(SC_MEDIA);
 		total_bytes += bytes;
-		iprintf("\x1b[1A\x1b[K0x%x/0x%x\n", total_bytes, romsize);
+		progress_set(total_bytes);
 	} while (bytes && total_bytes < 0x02000000);
+	progress_end();
+	iprintf("\x1b[1A\x1b[K0x%x/0x%x\n", total_bytes, romsize);
+	_SCSD_verifyReads = false;
+	launchlog_totals.load_ticks += systimer_ticks() - load_start;
+	PROFILE_END(PROFILE_FLASHROM);
 	
-	if(F_EOL)
-	{
-		if (settings.autosave) {
-			char savname[PATH_MAX];
-			strcpy(savname, path);
-			strcpy(savname + pathlen - ext_length(path), ".sav");
-			loadSram(savname);
+	if (F_EOL)
+		FinishROM(path, pathlen);
+}
 
-			FILE *lastSaved = fopen("/scfw/lastsaved.txt", "w+b");
-			fwrite(savname, strlen(savname), 1, lastSaved);
-			fclose(lastSaved);
+// Loads a mapped file like FlashROM, straight from its sectors
+void FlashMapped(const char *path, const struct fatmap_file *file, const struct fatmap_extent *extents, u32 romsize) {
+	u32 left = file->size;
+
+	if (file->extents_len) {
+		PROFILE_BEGIN(PROFILE_FLASHROM);
+		u32 load_start = systimer_ticks();
+		_SCSD_verifyReads = settings.verify_reads;
+		progress_begin(romsize);
+		for (u32 i = 0; i < file->extents_len && left; ++i) {
+			u32 sector = extents[i].sector;
+			u32 sectors = extents[i].sectors;
+			while (sectors && left) {
+				u32 chunk = sectors < sizeof filebuf / 512 ? sectors : sizeof filebuf / 512;
+				if (!_my_io_scsd.readSectors(sector, chunk, filebuf))
+					break;
+				bytes = chunk * 512 < left ? chunk * 512 : left;
+				launchlog_totals.bytes_loaded += bytes;
+				sc_mode(SC_RAM_RW);
+				DMA_Copy(3, filebuf, &GBA_ROM[total_bytes >> 2], DMA32 | bytes >> 2);
+				sc_mode(SC_MEDIA);
+				total_bytes += bytes;
+				left -= bytes;
+				sector += chunk;
+				sectors -= chunk;
+				progress_set(total_bytes);
+			}
+			if (sectors && left)
+				break;
 		}
-
-		if (settings.waitstate_patch) {
-			iprintf("Applying waitstate patches...\n");
-			sc_mode(SC_RAM_RW);
-			patchGeneralWhiteScreen();
-			patchSpecificGame();
-			iprintf("Waitstate patch done!\n");
+		progress_end();
+		_SCSD_verifyReads = false;
+		launchlog_totals.load_ticks += systimer_ticks() - load_start;
+		PROFILE_END(PROFILE_FLASHROM);
+		if (!left) {
+			iprintf("\x1b[1A\x1b[K0x%x/0x%x\n", total_bytes, romsize);
+			return;
 		}
+	}
 
-		if (settings.sram_patch) {
-			iprintf("Applying SRAM patch...\n");
-			sc_mode(SC_RAM_RW);
-			const struct save_type* saveType = savingAllowed ? save_findTag() : NULL;
-			if (saveType != NULL && saveType->patchFunc != NULL){
-				bool done = saveType->patchFunc(saveType);
-				if(!done)
-					printf("Save Type Patch Error\n");
-			} else {
-				printf("No need to patch\n");
-			}
-		}
-		
-		if (settings.soft_reset_patch)
-			resetPatch(romSize);
+	// Too fragmented to map, or a sector failed to read: carry on through libfat
+	FILE *rom = fopen(path, "rb");
+	if (!rom)
+		return;
+	fseek(rom, file->size - left, SEEK_SET);
+	FlashROM(NULL, 0, rom, romsize, false);
+	fclose(rom);
+}
+
+void FlashAsset(const struct asset *asset, u32 romsize) {
+	FlashMapped(asset->path, &asset->file, asset->extents, romsize);
+}
+
+// Emulators are kept in the last MB of SDRAM, from 31MB on, as they were
+// loaded, since the patches change the copy the game runs from. Launching the same one again
+// copies it down instead of reading it from the card.
+#define CORE_MAGIC 0x45524F43	// "CORE"
+#define CORE_STASH ((vu32*) 0x09f00000)
+#define CORE_STASH_MAX 0xfe000	// 1016KB, up to where the soft reset hook may go
+
+struct core_stash {
+	u32 magic;
+	u32 size;
+	u32 check;
+};
+
+// After the resident image's descriptor
+#define CORE_DESC ((volatile struct core_stash*) 0x09ffffe0)
+
+static void sdram_copy(vu32 *dst, vu32 *src, u32 words) {
+	while (words) {
+		u32 count = words < 0x4000 ? words : 0x4000;
+		DMA_Copy(3, src, dst, DMA32 | count);
+		dst += count;
+		src += count;
+		words -= count;
+	}
+}
+
+// Covers the file's directory entry, so a replaced emulator isn't taken for the old one
+static u32 core_check(const struct asset *core, u32 words) {
+	u32 hash = 0x811C9DC5;
+	for (const char *c = core->path; *c; ++c) {
+		hash ^= (u8)*c;
+		hash *= 0x01000193;
+	}
+	for (u32 i = 0; i < sizeof core->file.entry; ++i) {
+		hash ^= core->file.entry[i];
+		hash *= 0x01000193;
+	}
+	for (u32 i = 0; i < words; ++i) {
+		hash ^= CORE_STASH[i];
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
+void FlashCore(const struct asset *core, u32 romsize) {
+	u32 size = core->file.size;
+	u32 words = (size + 3) >> 2;
+	if (!core->file.entry_sector || size > CORE_STASH_MAX) {
+		FlashAsset(core, romsize);
+		return;
+	}
+
+	sc_mode(SC_RAM_RW);
+	bool stashed = CORE_DESC->magic == CORE_MAGIC && CORE_DESC->size == size && CORE_DESC->check == core_check(core, words);
+	if (stashed)
+		sdram_copy(&GBA_ROM[total_bytes >> 2], CORE_STASH, words);
+	sc_mode(SC_MEDIA);
+	if (stashed) {
+		total_bytes += size;
+		iprintf("\x1b[1A\x1b[K0x%x/0x%x\n", total_bytes, romsize);
+		return;
+	}
+
+	u32 start = total_bytes;
+	FlashAsset(core, romsize);
+	if (total_bytes - start != size)
+		return;
+	sc_mode(SC_RAM_RW);
+	CORE_DESC->magic = 0;
+	sdram_copy(CORE_STASH, &GBA_ROM[start >> 2], words);
+	CORE_DESC->size = size;
+	CORE_DESC->check = core_check(core, words);
+	CORE_DESC->magic = CORE_MAGIC;
+	sc_mode(SC_MEDIA);
+}
+
+// One bundle per emulator and file type, e.g. smsa_gg
+static void bundle_name(char *name, const char *core, const char *path) {
+	const char *ext = strrchr(path, '.');
+	char *ptr = stpcpy(stpcpy(name, core), "_");
+	for (ext = ext ? ext + 1 : ""; *ext && ptr < name + BUNDLE_NAME_MAX - 1; ++ext)
+		*ptr++ = tolower((u8) *ext);
+	*ptr = '\0';
+}
+
+// Streams everything up to the game from the launch's bundle, if there is a
+// current one. Otherwise nothing is loaded and the caller goes the long way.
+static bool LoadBundle(const char *core, const char *path, const char *const inputs[], u32 inputs_len) {
+	char name[BUNDLE_NAME_MAX + 8];
+
+	if (!settings.bundle_cache)
+		return false;
+	bundle_name(name, core, path);
+	const struct asset *bundle = bundle_get(name, inputs, inputs_len);
+	if (!bundle)
+		return false;
+	iprintf("Loading bundle %s\n\n", name);
+	FlashAsset(bundle, bundle->file.size);
+	if (total_bytes == bundle->file.size) {
+		romSize = bundle->file.size;
+		return true;
 	}
+	// The caller's romSize still holds, the long way starts over
+	total_bytes = 0;
+	return false;
+}
+
+// Writes what the long way loaded out as the bundle for the next launch
+static void StoreBundle(const char *core, const char *path, const char *const inputs[], u32 inputs_len) {
+	char name[BUNDLE_NAME_MAX + 8];
+
+	if (!settings.bundle_cache)
+		return;
+	bundle_name(name, core, path);
+	FILE *file = bundle_begin(name);
+	if (!file)
+		return;
+	iprintf("Caching bundle %s\n\n", name);
+	bundle_end(file, name, inputs, inputs_len, sdram_write(file, total_bytes));
 }
 
 void smsa_f(char path[], struct smsa_h *head, const char *out, const char *bin_id) {
@@ -777,14 +957,126 @@ void mpa2_f(char path[], struct mpa2_h *head, const char *out){
 
 }
 
+// The parts of the patch stage an image has been through, prebuilt or resident
+static u32 prebuilt_patches() {
+	return (settings.waitstate_patch ? PREBUILT_PATCH_WAITSTATE : 0)
+		| (settings.sram_patch ? PREBUILT_PATCH_SRAM : 0)
+		| (settings.soft_reset_patch ? PREBUILT_PATCH_SOFT_RESET : 0);
+}
+
+// Describes the image the last launch left in SDRAM. SDRAM keeps its contents
+// through a reset and only launches write to it, so while this still matches
+// the image can be started again without loading or patching it.
+#define RESIDENT_MAGIC 0x44495352	// "RSID"
+#define RESIDENT_SAMPLES 256
+
+struct resident {
+	u32 magic;
+	u32 size;
+	u32 check;
+	u16 save_type;
+	u16 patches;		// prebuilt_patches() when it was built
+	// The game file as it was loaded: a replaced one no longer matches
+	u32 cluster;
+	u32 file_size;
+	u32 mtime;
+};
+
+// After the reset token, past the end of any image smaller than 32MB
+#define RESIDENT ((volatile struct resident*) 0x09ffffc0)
+_Static_assert(sizeof(struct resident) <= 0x20, "the resident descriptor must end where CORE_DESC begins");
+
+// Mixes the path with the header and words spread over the rest of the image
+static u32 resident_check(const char *path, u32 size) {
+	u32 hash = 0x811C9DC5;
+	while (*path) {
+		hash ^= (u8)*path++;
+		hash *= 0x01000193;
+	}
+	u32 step = (size >> 2) / RESIDENT_SAMPLES + 1;
+	for (u32 i = 0; i < size >> 2; i += i < 0xc0 >> 2 ? 1 : step) {
+		hash ^= GBA_ROM[i];
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
+// Where the game file lies, its size and write time. All 0 for a compilation,
+// which only exists in SDRAM.
+static void resident_file(const char *path, u32 *cluster, u32 *file_size, u32 *mtime) {
+	struct stat st;
+	*cluster = *file_size = *mtime = 0;
+	// libfat reports a file's first cluster as its inode number
+	if (!stat(path, &st)) {
+		*cluster = st.st_ino;
+		*file_size = st.st_size;
+		*mtime = st.st_mtime;
+	}
+}
+
+// Called before SDRAM is written, a half loaded image is never reused. Left
+// alone when there is no descriptor, the words may belong to a big image.
+void resident_forget() {
+	sc_mode(SC_RAM_RW);
+	if (RESIDENT->magic == RESIDENT_MAGIC)
+		RESIDENT->magic = 0;
+	sc_mode(SC_MEDIA);
+}
+
+void resident_mark(const char *path, u32 size, u16 save_type) {
+	if (size > (u32) RESIDENT - (u32) GBA_ROM)
+		return;
+	u32 cluster, file_size, mtime;
+	resident_file(path, &cluster, &file_size, &mtime);
+	sc_mode(SC_RAM_RW);
+	RESIDENT->size = size;
+	RESIDENT->save_type = save_type;
+	RESIDENT->patches = prebuilt_patches();
+	RESIDENT->cluster = cluster;
+	RESIDENT->file_size = file_size;
+	RESIDENT->mtime = mtime;
+	RESIDENT->check = resident_check(path, size);
+	RESIDENT->magic = RESIDENT_MAGIC;
+	sc_mode(SC_MEDIA);
+}
+
+// Whether SDRAM still holds the image launched from path, built from the file
+// as it is now and with the patches turned on now, and how big it is
+bool resident_find(const char *path, u32 *size, u16 *save_type) {
+	u32 cluster, file_size, mtime;
+	resident_file(path, &cluster, &file_size, &mtime);
+	sc_mode(SC_RAM_RW);
+	*size = RESIDENT->size;
+	*save_type = RESIDENT->save_type;
+	bool found = RESIDENT->magic == RESIDENT_MAGIC && *size <= (u32) RESIDENT - (u32) GBA_ROM
+		&& RESIDENT->patches == prebuilt_patches() && RESIDENT->cluster == cluster
+		&& RESIDENT->file_size == file_size && RESIDENT->mtime == mtime
+		&& RESIDENT->check == resident_check(path, *size);
+	sc_mode(SC_MEDIA);
+	return found;
+}
+
 void L_Seq(char *path){
+	PROFILE_BEGIN(PROFILE_L_SEQ);
 	sc_mode(SC_MEDIA);
 	iprintf("Let's go.\n");
 	setLastPlayed(path);
+	launchlog_commit();
+	recent_commit(path, settings.sram_patch && savingAllowed ? launchlog_totals.save_type : RECENT_SAVE_UNKNOWN);
+	asset_save();
+	resident_mark(path, total_bytes, launchlog_totals.save_type);
+	PROFILE_END(PROFILE_L_SEQ);
+	// The rest of the launch doesn't return, so report while the card is still mapped.
+	// An autoboot never showed the boot phases, they go in with the launch.
+	if (autobooting)
+		PROFILE_REPORT("autoboot", PROFILE_AUTOBOOT);
+	else
+		PROFILE_REPORT("launch", PROFILE_LAUNCH);
 
 	sc_mode(SC_RAM_RO);
 	REG_IME = 0;
 	
+	systimer_stop();
 	restore_ewram_clocks();
 	
 	if (settings.biosboot)
@@ -793,19 +1085,160 @@ void L_Seq(char *path){
 		SoftReset(ROM_RESTART);
 }
 
+// A GBA ROM loaded into SDRAM ahead of time while the cursor rests on it.
+// Only whole chunks go in, so a prefetch stopped anywhere is a valid prefix.
+#define PREFETCH_CHUNK 0x1000
+#define PREFETCH_TICKS_PER_FRAME SYSTIMER_MS(6)
+#define PREFETCH_DELAY SYSTIMER_MS(300)
+
+static struct {
+	char path[STATE_PATH_MAX];
+	FILE *file;
+	u32 loaded;
+} prefetch;
+
+static bool prefetch_step(u32 deadline) {
+	while (prefetch.file) {
+		u32 read = fread(filebuf, 1, PREFETCH_CHUNK, prefetch.file);
+		// A DMA count of 0 would copy the most it can
+		if (read >= 4) {
+			sc_mode(SC_RAM_RW);
+			DMA_Copy(3, filebuf, &GBA_ROM[prefetch.loaded >> 2], DMA32 | read >> 2);
+			sc_mode(SC_MEDIA);
+		}
+		prefetch.loaded += read;
+		if (read < PREFETCH_CHUNK || prefetch.loaded >= 0x02000000) {
+			fclose(prefetch.file);
+			prefetch.file = NULL;
+		} else if (systimer_expired(deadline)) {
+			break;
+		}
+	}
+	return prefetch.file;
+}
+
+// Stops loading, what is in SDRAM is no longer of use
+void prefetch_cancel() {
+	if (prefetch.file)
+		fclose(prefetch.file);
+	prefetch.file = NULL;
+	prefetch.path[0] = '\0';
+}
+
+void prefetch_start(const char *path) {
+	u32 pathlen = strlen(path);
+	prefetch_cancel();
+	if (pathlen >= sizeof prefetch.path || pathlen <= 4 || strcasecmp(path + pathlen - 4, ".gba"))
+		return;
+	prefetch.file = fopen(path, "rb");
+	if (!prefetch.file)
+		return;
+	strcpy(prefetch.path, path);
+	prefetch.loaded = 0;
+	resident_forget();
+	idle_add("prefetch", prefetch_step, PREFETCH_TICKS_PER_FRAME);
+}
+
+// How much of the ROM at path is already in SDRAM, the launch loads the rest
+u32 prefetch_take(const char *path) {
+	u32 loaded = strcmp(prefetch.path, path) ? 0 : prefetch.loaded;
+	prefetch_cancel();
+	return loaded;
+}
+
+// Streams the game's prebuilt image in place of loading and patching it,
+// false if it has no current one. scpack builds Master System games for
+// SMSAdvance without a BIOS, the image is only right while a launch would be.
+static bool LaunchPrebuilt(char *path, u32 pathlen) {
+	struct prebuilt_header header;
+	struct prebuilt_block block;
+
+	if (!settings.prebuilt)
+		return false;
+	bool sms = (pathlen > 4 && !strcasecmp(path + pathlen - 4, ".sms")) || (pathlen > 3 && !strcasecmp(path + pathlen - 3, ".gg"));
+	bool sg = pathlen > 3 && !strcasecmp(path + pathlen - 3, ".sg");
+	if (((sms || sg) && settings.smsa_bios) || (sms && settings.DrSMS_prio))
+		return false;
+	FILE *image = prebuilt_open(path, prebuilt_patches(), &header);
+	if (!image)
+		return false;
+
+	// They lie past the end of the image, so they can go in first
+	bool ok = header.image_size <= 0x02000000;
+	for (u32 i = 0; ok && i < header.blocks; ++i) {
+		ok = fread(&block, sizeof block, 1, image) == 1 && block.size && !(block.size & 3) && block.size <= PREBUILT_BLOCK_MAX
+			&& block.offset >= header.image_size && block.offset <= 0x02000000 - block.size
+			&& fread(filebuf, 1, block.size, image) == block.size;
+		if (ok) {
+			sc_mode(SC_RAM_RW);
+			DMA_Copy(3, filebuf, &GBA_ROM[block.offset >> 2], DMA32 | block.size >> 2);
+			sc_mode(SC_MEDIA);
+		}
+	}
+	if (!ok) {
+		fclose(image);
+		return false;
+	}
+
+	romSize = header.image_size;
+	total_bytes = 0, bytes = 0;
+	iprintf("Loading prebuilt image:\n\n");
+	FlashROM(path, pathlen, image, romSize, false);
+	fclose(image);
+	if (total_bytes < header.image_size) {
+		iprintf("Prebuilt image is cut short\n");
+		tryAgain();
+	}
+
+	// Already patched, only the save is left
+	prepareSave(path, pathlen);
+	savingAllowed = header.saving_allowed;
+	if (settings.sram_patch)
+		launchlog_totals.save_type = header.save_type;
+	return true;
+}
+
+// Past what a recent game keeps mapped, a file is loaded through libfat
+#define FRAG_WARN_EXTENTS RECENT_EXTENTS
+
+// The last file launched in too many pieces, for the I/O diagnostics
+EWRAM_BSS static char fragmented[PATH_MAX];
+static u32 fragmented_extents;
+
+static void CheckFragmented(const char *path) {
+	u32 extents = fatmap_countExtents(path);
+	if (extents <= FRAG_WARN_EXTENTS)
+		return;
+	strcpy(fragmented, path);
+	fragmented_extents = extents;
+	iprintf("File is in %lu pieces,\nrun scdefrag on the card.\n\n", extents);
+}
+
 void selectFile(char *path) {
 	u32 pathlen = strlen(path);
-	if (pathlen > 4 && !strcasecmp(path + pathlen - 4, ".gba")) {
+	knownSaveType = RECENT_SAVE_UNKNOWN;
+	autosave_finish();
+	u32 prefetched = prefetch_take(path);
+	resident_forget();
+	asset_release();
+	launchlog_begin(path);
+	CheckFragmented(path);
+	if (LaunchPrebuilt(path, pathlen)) {
+		L_Seq(path);
+	} else if (pathlen > 4 && !strcasecmp(path + pathlen - 4, ".gba")) {
 		FILE *rom = fopen(path, "rb");
 		fseek(rom, 0, SEEK_END);
 		u32 romsize = ftell(rom);
 		romSize = romsize;
-		fseek(rom, 0, SEEK_SET);
+		fseek(rom, prefetched, SEEK_SET);
 
-		total_bytes = 0, bytes = 0;
+		total_bytes = prefetched, bytes = 0;
 		iprintf("Loading ROM:\n\n");
 		
-		FlashROM(path,pathlen,rom,romSize,true);
+		if (prefetched < romsize)
+			FlashROM(path,pathlen,rom,romSize,true);
+		else
+			FinishROM(path, pathlen);
 		fclose(rom);
 		L_Seq(path);
 	} else if (pathlen > 4 && !strcasecmp(path + pathlen - 4, ".frm")) {
@@ -865,10 +1298,12 @@ void selectFile(char *path) {
 			total_bytes = 0;
 			bytes = 0;
 			iprintf("Programming flash.\n\n");
+			progress_begin(fwsize);
 			do {
 				sc_mode(SC_MEDIA);
 				bytes = fread(filebuf, 1, sizeof filebuf, fw);
 				if (ferror(fw)) {
+					progress_end();
 					iprintf("Error reading file!\n");
 					goto fw_flash_end;
 				}
@@ -885,8 +1320,12 @@ void selectFile(char *path) {
 				}
 				sc_mode(SC_MEDIA);
 				total_bytes += bytes;
-				iprintf("\x1b[1A\x1b[K0x%x/0x%x\n", total_bytes, fwsize);
+				// Interrupts are off while flashing, so draw by hand
+				progress_set(total_bytes);
+				progress_draw();
 			} while (bytes);
+			progress_end();
+			iprintf("\x1b[1A\x1b[K0x%x/0x%x\n", total_bytes, fwsize);
 
 			iprintf("Done!\n");
 			fw_flash_end:
@@ -929,30 +1368,30 @@ void selectFile(char *path) {
 		u32 romsize = 0;
 		total_bytes = 0,bytes = 0;
 		const char *emu_bin = "/scfw/bwsc.gba";
-		FILE *emu = fopen(emu_bin, "rb");
+		const struct asset *emu = asset_get(emu_bin);
 		if (!emu) {
 			iprintf("Checking %s\n",emu_bin);
 			u_prompt("No SwanGBA found!\n\n");
-			fclose(emu);
 		} else {
-			fseek(emu,0,SEEK_END);
-			romsize = ftell(emu);
+			romsize = emu->file.size;
 			romSize = romsize;
-			fseek(emu, 0, SEEK_SET);
 			iprintf("Loading SwanGBA\n\n");
-			FlashROM(path,pathlen,emu,romSize,false);
 			struct bwsc_h head;
+			char bwsc_deps[64];
+			if (!strcasecmp(path + pathlen - 4, ".wsc"))
+				strcpy(bwsc_deps,"/scfw/[BIOS]bws_color.wsc");
+			if (!strcasecmp(path + pathlen - 4, ".pc2"))
+				strcpy(bwsc_deps,"/scfw/[BIOS]bws_pc2.wsc");
+			if (!strcasecmp(path + pathlen - 3, ".ws"))
+				strcpy(bwsc_deps,"/scfw/[BIOS]bws_og.wsc");
+			const char *bundle_inputs[] = { emu_bin, bwsc_deps };
+			bool bundled = settings.bwsc_bios && LoadBundle("bwsc", path, bundle_inputs, 2);
+			if (!bundled)
+				FlashCore(emu, romSize);
 			//
-			FILE *out_f0, *out_f1;
-			if (settings.bwsc_bios) {
-				char bwsc_deps[64];
+			FILE *out_f0;
+			if (settings.bwsc_bios && !bundled) {
 				const char *output_path;
-				if (!strcasecmp(path + pathlen - 4, ".wsc"))
-					strcpy(bwsc_deps,"/scfw/[BIOS]bws_color.wsc");
-				if (!strcasecmp(path + pathlen - 4, ".pc2"))
-					strcpy(bwsc_deps,"/scfw/[BIOS]bws_pc2.wsc");
-				if (!strcasecmp(path + pathlen - 3, ".ws"))
-					strcpy(bwsc_deps,"/scfw/[BIOS]bws_og.wsc");
 				output_path = "/scfw/bwsc_0.dat";
 				iprintf("... PLEASE WAIT ...\n\n");
 				bwsc_f(bwsc_deps, &head, output_path);
@@ -962,13 +1401,14 @@ void selectFile(char *path) {
 				romSize += romsize;
 				fseek(out_f0, 0, SEEK_SET);
 				FlashROM(path,pathlen,out_f0,romSize,false);
-				out_f1 = fopen(bwsc_deps, "rb");
-				fseek(out_f1, 0, SEEK_END);
-				romsize = ftell(out_f1);
+				fclose(out_f0);
+				const struct asset *bios = asset_get(bwsc_deps);
+				romsize = bios ? bios->file.size : 0;
 				romSize += romsize;
-				fseek(out_f1, 0, SEEK_SET);
 				iprintf("Loading SwanGBA BIOS:\n\n");
-				FlashROM(path,pathlen,out_f1,romSize,false);
+				if (bios)
+					FlashAsset(bios, romSize);
+				StoreBundle("bwsc", path, bundle_inputs, 2);
 			}
 			//BIOS FIRST THEN USER CFG ~ BIOS loading not supported atm
 			//
@@ -1012,105 +1452,113 @@ void selectFile(char *path) {
 			FlashROM(path,pathlen,rom,romSize,true);
 			fclose(rom);
 			fclose(out_h);
-			fclose(out_f1);
-			fclose(out_f0);
-			fclose(emu);
 			L_Seq(path);
 		}
 	} else if (pathlen > 4 && (!strcasecmp(path + pathlen - 4, ".fds") || !strcasecmp(path + pathlen - 4, ".nsf"))){
 		u32 romsize = 0;
 		total_bytes = 0,bytes = 0;
 		const char *emu_bin = "/scfw/hvca.gba";
-		FILE *emu = fopen(emu_bin, "rb");
+		const struct asset *emu = asset_get(emu_bin);
 		if (!emu) {
 			iprintf("Checking %s\n",emu_bin);
 			u_prompt("No HVCA found!\n\n");
-			fclose(emu);
 		} else {
-			fseek(emu,0,SEEK_END);
-			romsize = ftell(emu);
+			romsize = emu->file.size;
 			romSize = romsize;
-			fseek(emu, 0, SEEK_SET);
 			iprintf("Loading HVCA\n\n");
-			FlashROM(path,pathlen,emu,romSize,false);
 			struct hvca_h head;
 			char hvca_deps[64];
-			//First file
-			strcpy(hvca_deps,"/scfw/hvca/font_a.raw");
-			const char *output_path = "/scfw/hvca/hvca_0.dat";
-			iprintf("... PLEASE WAIT ...\n\n");
-			hvca_f(hvca_deps, &head, output_path);
-			FILE *out_f0 = fopen("/scfw/hvca/hvca_0.dat", "rb");
-			fseek(out_f0,0,SEEK_END);
-			romsize = ftell(out_f0);
-			romSize += romsize;
-			fseek(out_f0, 0, SEEK_SET);
-			FlashROM(path,pathlen,out_f0,romSize,false);
-			FILE *out_f1 = fopen("/scfw/hvca/font_a.raw", "rb");
-			fseek(out_f1, 0, SEEK_END);
-			romsize = ftell(out_f1);
-			romSize += romsize;
-			fseek(out_f1, 0, SEEK_SET);
-			iprintf("Loading HVCA dependency:\n\n");
-			FlashROM(path,pathlen,out_f1,romSize,false);
-			//Second file
-			strcpy(hvca_deps,"/scfw/hvca/font_k.raw");
-			output_path = "/scfw/hvca/hvca_1.dat";
-			hvca_f(hvca_deps, &head, output_path);
-			FILE *out_f2 = fopen("/scfw/hvca/hvca_1.dat", "rb");
-			fseek(out_f2,0,SEEK_END);
-			romsize = ftell(out_f2);
-			romSize += romsize;
-			fseek(out_f2, 0, SEEK_SET);
-			FlashROM(path,pathlen,out_f2,romSize,false);
-			FILE *out_f3 = fopen("/scfw/hvca/font_k.raw", "rb");
-			fseek(out_f3, 0, SEEK_END);
-			romsize = ftell(out_f3);
-			romSize += romsize;
-			fseek(out_f3, 0, SEEK_SET);
-			iprintf("Loading HVCA dependency:\n\n");
-			FlashROM(path,pathlen,out_f3,romSize,false);
-			//Third file
-			if(!strcasecmp(path + pathlen - 4, ".nsf"))
-				strcpy(hvca_deps,"/scfw/hvca/mapr/mnsf.bin");
-			if(!strcasecmp(path + pathlen - 4, ".fds"))
-				strcpy(hvca_deps,"/scfw/hvca/mapr/mfds.bin");
-			output_path = "/scfw/hvca/hvca_2.dat";
-			hvca_f(hvca_deps, &head, output_path);
-			FILE *out_f4 = fopen("/scfw/hvca/hvca_2.dat", "rb");
-			fseek(out_f4,0,SEEK_END);
-			romsize = ftell(out_f4);
-			romSize += romsize;
-			fseek(out_f4, 0, SEEK_SET);
-			FlashROM(path,pathlen,out_f4,romSize,false);
-			FILE *out_f5;
-			if(!strcasecmp(path + pathlen - 4, ".nsf"))
-				out_f5 = fopen("/scfw/hvca/mapr/mnsf.bin", "rb");
-			if(!strcasecmp(path + pathlen - 4, ".fds"))
-				out_f5 = fopen("/scfw/hvca/mapr/mfds.bin", "rb");
-			fseek(out_f5, 0, SEEK_END);
-			romsize = ftell(out_f5);
-			romSize += romsize;
-			fseek(out_f5, 0, SEEK_SET);
-			iprintf("Loading HVCA dependency:\n\n");
-			FlashROM(path,pathlen,out_f5,romSize,false);
-			//Fourth file
-			strcpy(hvca_deps,"/scfw/hvca/disksys.rom");
-			output_path = "/scfw/hvca/hvca_3.dat";
-			hvca_f(hvca_deps, &head, output_path);
-			FILE *out_f6 = fopen("/scfw/hvca/hvca_3.dat", "rb");
-			fseek(out_f6,0,SEEK_END);
-			romsize = ftell(out_f6);
-			romSize += romsize;
-			fseek(out_f6, 0, SEEK_SET);
-			FlashROM(path,pathlen,out_f6,romSize,false);
-			FILE *out_f7 = fopen("/scfw/hvca/disksys.rom", "rb");
-			fseek(out_f7, 0, SEEK_END);
-			romsize = ftell(out_f7);
-			romSize += romsize;
-			fseek(out_f7, 0, SEEK_SET);
-			iprintf("Loading HVCA dependency:\n\n");
-			FlashROM(path,pathlen,out_f7,romSize,false);
+			const char *output_path;
+			const char *mapper = !strcasecmp(path + pathlen - 4, ".nsf") ? "/scfw/hvca/mapr/mnsf.bin" : "/scfw/hvca/mapr/mfds.bin";
+			const char *bundle_inputs[] = { emu_bin, "/scfw/hvca/font_a.raw", "/scfw/hvca/font_k.raw", mapper, "/scfw/hvca/disksys.rom" };
+			if (!LoadBundle("hvca", path, bundle_inputs, 5)) {
+				FlashCore(emu, romSize);
+				//First file
+				strcpy(hvca_deps,"/scfw/hvca/font_a.raw");
+				output_path = "/scfw/hvca/hvca_0.dat";
+				iprintf("... PLEASE WAIT ...\n\n");
+				hvca_f(hvca_deps, &head, output_path);
+				FILE *out_f0 = fopen("/scfw/hvca/hvca_0.dat", "rb");
+				fseek(out_f0,0,SEEK_END);
+				romsize = ftell(out_f0);
+				romSize += romsize;
+				fseek(out_f0, 0, SEEK_SET);
+				FlashROM(path,pathlen,out_f0,romSize,false);
+				fclose(out_f0);
+				FILE *out_f1 = fopen("/scfw/hvca/font_a.raw", "rb");
+				fseek(out_f1, 0, SEEK_END);
+				romsize = ftell(out_f1);
+				romSize += romsize;
+				fseek(out_f1, 0, SEEK_SET);
+				iprintf("Loading HVCA dependency:\n\n");
+				FlashROM(path,pathlen,out_f1,romSize,false);
+				fclose(out_f1);
+				//Second file
+				strcpy(hvca_deps,"/scfw/hvca/font_k.raw");
+				output_path = "/scfw/hvca/hvca_1.dat";
+				hvca_f(hvca_deps, &head, output_path);
+				FILE *out_f2 = fopen("/scfw/hvca/hvca_1.dat", "rb");
+				fseek(out_f2,0,SEEK_END);
+				romsize = ftell(out_f2);
+				romSize += romsize;
+				fseek(out_f2, 0, SEEK_SET);
+				FlashROM(path,pathlen,out_f2,romSize,false);
+				fclose(out_f2);
+				FILE *out_f3 = fopen("/scfw/hvca/font_k.raw", "rb");
+				fseek(out_f3, 0, SEEK_END);
+				romsize = ftell(out_f3);
+				romSize += romsize;
+				fseek(out_f3, 0, SEEK_SET);
+				iprintf("Loading HVCA dependency:\n\n");
+				FlashROM(path,pathlen,out_f3,romSize,false);
+				fclose(out_f3);
+				//Third file
+				if(!strcasecmp(path + pathlen - 4, ".nsf"))
+					strcpy(hvca_deps,"/scfw/hvca/mapr/mnsf.bin");
+				if(!strcasecmp(path + pathlen - 4, ".fds"))
+					strcpy(hvca_deps,"/scfw/hvca/mapr/mfds.bin");
+				output_path = "/scfw/hvca/hvca_2.dat";
+				hvca_f(hvca_deps, &head, output_path);
+				FILE *out_f4 = fopen("/scfw/hvca/hvca_2.dat", "rb");
+				fseek(out_f4,0,SEEK_END);
+				romsize = ftell(out_f4);
+				romSize += romsize;
+				fseek(out_f4, 0, SEEK_SET);
+				FlashROM(path,pathlen,out_f4,romSize,false);
+				fclose(out_f4);
+				FILE *out_f5;
+				if(!strcasecmp(path + pathlen - 4, ".nsf"))
+					out_f5 = fopen("/scfw/hvca/mapr/mnsf.bin", "rb");
+				if(!strcasecmp(path + pathlen - 4, ".fds"))
+					out_f5 = fopen("/scfw/hvca/mapr/mfds.bin", "rb");
+				fseek(out_f5, 0, SEEK_END);
+				romsize = ftell(out_f5);
+				romSize += romsize;
+				fseek(out_f5, 0, SEEK_SET);
+				iprintf("Loading HVCA dependency:\n\n");
+				FlashROM(path,pathlen,out_f5,romSize,false);
+				fclose(out_f5);
+				//Fourth file
+				strcpy(hvca_deps,"/scfw/hvca/disksys.rom");
+				output_path = "/scfw/hvca/hvca_3.dat";
+				hvca_f(hvca_deps, &head, output_path);
+				FILE *out_f6 = fopen("/scfw/hvca/hvca_3.dat", "rb");
+				fseek(out_f6,0,SEEK_END);
+				romsize = ftell(out_f6);
+				romSize += romsize;
+				fseek(out_f6, 0, SEEK_SET);
+				FlashROM(path,pathlen,out_f6,romSize,false);
+				fclose(out_f6);
+				FILE *out_f7 = fopen("/scfw/hvca/disksys.rom", "rb");
+				fseek(out_f7, 0, SEEK_END);
+				romsize = ftell(out_f7);
+				romSize += romsize;
+				fseek(out_f7, 0, SEEK_SET);
+				iprintf("Loading HVCA dependency:\n\n");
+				FlashROM(path,pathlen,out_f7,romSize,false);
+				fclose(out_f7);
+				StoreBundle("hvca", path, bundle_inputs, 5);
+			}
 			//Fifth file (FDS ROM!)
 			strcpy(hvca_deps,path);
 			output_path = "/scfw/hvca/hvca_4.dat";
@@ -1146,15 +1594,6 @@ void selectFile(char *path) {
 			FlashROM(path,pathlen,out_f9,romSize,true); //Close after the last rom
 			fclose(out_f9);
 			fclose(out_f8);
-			fclose(out_f7);
-			fclose(out_f6);
-			fclose(out_f5);
-			fclose(out_f4);
-			fclose(out_f3);
-			fclose(out_f2);
-			fclose(out_f1);
-			fclose(out_f0);
-			fclose(emu);
 			fclose(rom);
 			L_Seq(path);
 		}
@@ -1166,18 +1605,15 @@ void selectFile(char *path) {
 			emu_bin = "/scfw/gb.gba";
 		else
 			emu_bin = "/scfw/gbc.gba";
-		FILE *emu = fopen(emu_bin, "rb");
+		const struct asset *emu = asset_get(emu_bin);
 		if (!emu) {
 			iprintf("Checking %s\n",emu_bin);
 			u_prompt("No Goomba found!\n\n");
-			fclose(emu);
 		} else {
-			fseek(emu,0,SEEK_END);
-			romsize = ftell(emu);
+			romsize = emu->file.size;
 			romSize = romsize;
-			fseek(emu, 0, SEEK_SET);
 			iprintf("Loading Goomba \n\n");
-			FlashROM(path,pathlen,emu,romSize,false);
+			FlashCore(emu, romSize);
 			FILE *rom = fopen(path, "rb");
 			fseek(rom, 0, SEEK_END);
 			romsize = ftell(rom);
@@ -1186,46 +1622,28 @@ void selectFile(char *path) {
 			iprintf("Loading ROM:\n\n");
 			FlashROM(path,pathlen,rom,romSize,true);
 			fclose(rom);
-			fclose(emu);
 			L_Seq(path);
 		}
 	} else if (pathlen > 4 && !strcasecmp(path + pathlen - 4, ".nes")){
 		u32 romsize = 0;
 		total_bytes = 0,bytes = 0;
 		const char *emu_bin = "/scfw/nes.gba";
-		FILE *emu = fopen(emu_bin, "rb");
+		const struct asset *emu = asset_get(emu_bin);
 		if (!emu) {
 			iprintf("Checking %s\n",emu_bin);
 			u_prompt("No PocketNES found!\n\n");
-			fclose(emu);
 		} else {
-			fseek(emu,0,SEEK_END);
-			romsize = ftell(emu);
+			romsize = emu->file.size;
 			romSize = romsize;
-			fseek(emu, 0, SEEK_SET);
 			iprintf("Loading PocketNES\n\n");
-			FlashROM(path,pathlen,emu,romSize,false);
+			FlashCore(emu, romSize);
 			struct pnes_h header;
-			char bname_b[32];
-			strncpy(bname_b, basename(path), sizeof(bname_b) - 1);
-			bname_b[sizeof(bname_b) - 1] = '\0'; 
-			strcpy(header.name, bname_b);
 			FILE *rom = fopen(path, "rb");
 			fseek(rom, 0, SEEK_END);
 			romsize = ftell(rom);
-			header.filesize = 0;
-			header.filesize = romsize;
-			header.flags = 0;
 			iprintf("Analyzing ROM...\n\n");
-			if (strcasestr(basename(path), "(E)") || strcasestr(basename(path), "(EUR)") || strcasestr(basename(path), "(Europe)")) {
-				header.flags |= (1 << 2);
-				iprintf("PAL timing\n");
-			} else {
-				header.flags |= (1 << 4);
-				iprintf("NTSC timing\n");
-			}
-			header.follow = 0;
-			header.reserved = 0;
+			romhead_pnes(&header, path, romsize);
+			iprintf(header.flags & (1 << 2) ? "PAL timing\n" : "NTSC timing\n");
 			FILE *out_h = fopen("/scfw/pnes_h.dat", "w+b");
 			fwrite(&header,1, sizeof header, out_h);
 			fclose(out_h);
@@ -1243,25 +1661,21 @@ void selectFile(char *path) {
 			FlashROM(path,pathlen,rom,romSize,true);
 			fclose(rom);
 			fclose(out_h);
-			fclose(emu);
 			L_Seq(path);
 		}
 	} else if (pathlen > 4 && !strcasecmp(path + pathlen - 4, ".pce")){
 		u32 romsize = 0;
 		total_bytes = 0,bytes = 0;
 		const char *emu_bin = "/scfw/pcea.gba";
-		FILE *emu = fopen(emu_bin, "rb");
+		const struct asset *emu = asset_get(emu_bin);
 		if (!emu) {
 			iprintf("Checking %s\n",emu_bin);
 			u_prompt("No PCEAdvance found!\n\n");
-			fclose(emu);
 		} else {
-			fseek(emu,0,SEEK_END);
-			romsize = ftell(emu);
+			romsize = emu->file.size;
 			romSize = romsize;
-			fseek(emu, 0, SEEK_SET);
 			iprintf("Loading PCEAdvance\n\n");
-			FlashROM(path,pathlen,emu,romSize,false);
+			FlashCore(emu, romSize);
 			struct pcea_h header;
 			char bname_b[32];
 			strncpy(bname_b, basename(path), sizeof(bname_b) - 1);
@@ -1311,36 +1725,35 @@ void selectFile(char *path) {
 			FlashROM(path,pathlen,rom,romSize,true);
 			fclose(rom);
 			fclose(out_h);
-			fclose(emu);
 			L_Seq(path);
 		}
 	} else if ((!settings.DrSMS_prio && ((pathlen > 4 && !strcasecmp(path + pathlen - 4, ".sms")) || (pathlen > 3 && !strcasecmp(path + pathlen - 3, ".gg")))) || (pathlen > 3 && !strcasecmp(path + pathlen - 3, ".sg"))){
 		u32 romsize = 0;
 		total_bytes = 0,bytes = 0;
 		const char *emu_bin = "/scfw/smsa.gba";
-		FILE *emu = fopen(emu_bin, "rb");
+		const struct asset *emu = asset_get(emu_bin);
 		if (!emu) {
 			iprintf("Checking %s\n",emu_bin);
 			u_prompt("No SMSAdvance found!\n\n");
-			fclose(emu);
 		} else {
-			fseek(emu,0,SEEK_END);
-			romsize = ftell(emu);
+			romsize = emu->file.size;
 			romSize = romsize;
-			fseek(emu, 0, SEEK_SET);
 			iprintf("Loading SMSAdvance\n\n");
-			FlashROM(path,pathlen,emu,romSize,false);
 			struct smsa_h head;
 			char smsa_deps[64];
+			if (!strcasecmp(path + pathlen - 4, ".sms"))
+				strcpy(smsa_deps,"/scfw/[BIOS]smsa_sms.rom");
+			if (!strcasecmp(path + pathlen - 3, ".sg"))
+				strcpy(smsa_deps,"/scfw/[BIOS]smsa_sg.rom");
+			if (!strcasecmp(path + pathlen - 3, ".gg"))
+				strcpy(smsa_deps,"/scfw/[BIOS]smsa_gg.rom");
+			const char *bundle_inputs[] = { emu_bin, smsa_deps };
+			bool bundled = settings.smsa_bios && LoadBundle("smsa", path, bundle_inputs, 2);
+			if (!bundled)
+				FlashCore(emu, romSize);
 			const char *output_path;
-			FILE *out_f0, *out_f1;
-			if (settings.smsa_bios) {
-				if (!strcasecmp(path + pathlen - 4, ".sms"))
-					strcpy(smsa_deps,"/scfw/[BIOS]smsa_sms.rom");
-				if (!strcasecmp(path + pathlen - 3, ".sg"))
-					strcpy(smsa_deps,"/scfw/[BIOS]smsa_sg.rom");
-				if (!strcasecmp(path + pathlen - 3, ".gg"))
-					strcpy(smsa_deps,"/scfw/[BIOS]smsa_gg.rom");
+			FILE *out_f0;
+			if (settings.smsa_bios && !bundled) {
 				output_path = "/scfw/smsa_0.dat";
 				iprintf("... PLEASE WAIT ...\n\n");
 				smsa_f(smsa_deps, &head, output_path, "SMS");
@@ -1350,51 +1763,23 @@ void selectFile(char *path) {
 				romSize += romsize;
 				fseek(out_f0, 0, SEEK_SET);
 				FlashROM(path,pathlen,out_f0,romSize,false);
-				out_f1 = fopen(smsa_deps, "rb");
-				fseek(out_f1, 0, SEEK_END);
-				romsize = ftell(out_f1);
+				fclose(out_f0);
+				const struct asset *bios = asset_get(smsa_deps);
+				romsize = bios ? bios->file.size : 0;
 				romSize += romsize;
-				fseek(out_f1, 0, SEEK_SET);
 				iprintf("Loading SMSA BIOS:\n\n");
-				FlashROM(path,pathlen,out_f1,romSize,false);
+				if (bios)
+					FlashAsset(bios, romSize);
+				StoreBundle("smsa", path, bundle_inputs, 2);
 			}
 			//Flash SMSA ROM
-			head.id = u32conv("SMS") | (0x1A << 24);
 			FILE *rom = fopen(path, "rb");
 			fseek(rom, 0, SEEK_END);
 			romsize = ftell(rom);
-			head.filesize = 0;
-			head.filesize = romsize;
-			head.flags = 0;
 			iprintf("Analyzing ROM...\n\n");
-			if (strcasestr(basename(path), "(E)") || strcasestr(basename(path), "(EUR)") || strcasestr(basename(path), "(Europe)")) {
-				head.flags |= (1 << 0);
-				iprintf("PAL timing\n\n");
-			} else {
-				head.flags |= (0 << 0);
-				iprintf("NTSC timing\n\n");
-			}
-			if (strcasestr(basename(path), "(J)") || strcasestr(basename(path), "(JAPAN)")) {
-				head.flags |= (1 << 1);
-				iprintf("Japan ROM\n\n");
-			} else {
-				head.flags |= (0 << 1);
-				iprintf("USA/EUR ROM\n\n");
-			}
-			if(!strcasecmp(path + pathlen - 4, ".sms") || !strcasecmp(path + pathlen - 3, ".sg"))
-				head.flags |= (0 << 2);
-			else
-				head.flags |= (1 << 2);
-			head.hacks = 0;
-			head.follow = 0;
-			head.B_flag = 0;
-			head.res0 = 0;
-			head.res1 = 0;
-			head.res2 = 0;
-			char bname_b[32];
-			strncpy(bname_b, basename(path), sizeof(bname_b) - 1);
-			bname_b[sizeof(bname_b) - 1] = '\0'; 
-			strcpy(head.name, bname_b);
+			romhead_smsa(&head, path, romsize);
+			iprintf(head.flags & (1 << 0) ? "PAL timing\n\n" : "NTSC timing\n\n");
+			iprintf(head.flags & (1 << 1) ? "Japan ROM\n\n" : "USA/EUR ROM\n\n");
 			FILE *out_h = fopen("/scfw/smsa_1.dat", "w+b");
 			fwrite(&head,1, sizeof head, out_h);
 			fclose(out_h);
@@ -1412,27 +1797,21 @@ void selectFile(char *path) {
 			FlashROM(path,pathlen,rom,romSize,true);
 			fclose(rom);
 			fclose(out_h);
-			fclose(out_f1);
-			fclose(out_f0);
-			fclose(emu);
 			L_Seq(path);
 		}
 	} else if (settings.DrSMS_prio && ((pathlen > 4 && !strcasecmp(path + pathlen - 4, ".sms")) || (pathlen > 3 && !strcasecmp(path + pathlen - 3, ".gg")))){
 		u32 romsize = 0;
 		total_bytes = 0,bytes = 0;
 		const char *emu_bin = "/scfw/drsms.gba";
-		FILE *emu = fopen(emu_bin, "rb");
+		const struct asset *emu = asset_get(emu_bin);
 		if (!emu) {
 			iprintf("Checking %s\n",emu_bin);
 			u_prompt("No DrSMS found!\n\n");
-			fclose(emu);
 		} else {
-			fseek(emu,0,SEEK_END);
-			romsize = ftell(emu);
+			romsize = emu->file.size;
 			romSize = romsize;
-			fseek(emu, 0, SEEK_SET);
 			iprintf("Loading DrSMS\n\n");
-			FlashROM(path,pathlen,emu,romSize,false);
+			FlashCore(emu, romSize);
 			struct drsms_h head;
 			const char *output_path;
 			head.id = 1;
@@ -1497,32 +1876,30 @@ void selectFile(char *path) {
 			FlashROM(path,pathlen,rom,romSize,true);
 			fclose(rom);
 			fclose(out_h);
-			fclose(emu);
 			L_Seq(path);
 		}
 	} else if (pathlen > 3 && !strcasecmp(path + pathlen - 3, ".sv")){
 		u32 romsize = 0;
 		total_bytes = 0,bytes = 0;
 		const char *emu_bin = "/scfw/wsv.gba";
-		FILE *emu = fopen(emu_bin, "rb");
+		const struct asset *emu = asset_get(emu_bin);
 		if (!emu) {
 			iprintf("Checking %s\n",emu_bin);
 			u_prompt("No WasabiGBA found!\n\n");
-			fclose(emu);
 		} else {
-			fseek(emu,0,SEEK_END);
-			romsize = ftell(emu);
+			romsize = emu->file.size;
 			romSize = romsize;
-			fseek(emu, 0, SEEK_SET);
 			iprintf("Loading WasabiGBA\n\n");
-			FlashROM(path,pathlen,emu,romSize,false);
 			struct wsv_h head;
 			char wsv_deps[64];
+			strcpy(wsv_deps,"/scfw/[BIOS]wsv.rom");
+			const char *bundle_inputs[] = { emu_bin, wsv_deps };
+			bool bundled = settings.wsv_bios && LoadBundle("wsv", path, bundle_inputs, 2);
+			if (!bundled)
+				FlashCore(emu, romSize);
 			const char *output_path;
-			FILE *out_f0, *out_f1;
-			if (settings.wsv_bios) {
-				if (!strcasecmp(path + pathlen - 3, ".sv"))
-					strcpy(wsv_deps,"/scfw/[BIOS]wsv.rom");
+			FILE *out_f0;
+			if (settings.wsv_bios && !bundled) {
 				output_path = "/scfw/wsv_0.dat";
 				iprintf("... PLEASE WAIT ...\n\n");
 				wsv_f(wsv_deps, &head, output_path);
@@ -1532,13 +1909,14 @@ void selectFile(char *path) {
 				romSize += romsize;
 				fseek(out_f0, 0, SEEK_SET);
 				FlashROM(path,pathlen,out_f0,romSize,false);
-				out_f1 = fopen(wsv_deps, "rb");
-				fseek(out_f1, 0, SEEK_END);
-				romsize = ftell(out_f1);
+				fclose(out_f0);
+				const struct asset *bios = asset_get(wsv_deps);
+				romsize = bios ? bios->file.size : 0;
 				romSize += romsize;
-				fseek(out_f1, 0, SEEK_SET);
 				iprintf("Loading WSV BIOS:\n\n");
-				FlashROM(path,pathlen,out_f1,romSize,false);
+				if (bios)
+					FlashAsset(bios, romSize);
+				StoreBundle("wsv", path, bundle_inputs, 2);
 			}
 			head.id = u32conv("VSW") | (0x1A << 24);
 			FILE *rom = fopen(path, "rb");
@@ -1572,37 +1950,34 @@ void selectFile(char *path) {
 			FlashROM(path,pathlen,rom,romSize,true);
 			fclose(rom);
 			fclose(out_f2);
-			fclose(out_f1);
-			fclose(out_f0);
-			fclose(emu);
 			L_Seq(path);
 		}
 	} else if (pathlen > 4 && (!strcasecmp(path + pathlen - 4, ".ngp") || !strcasecmp(path + pathlen - 4, ".ngc"))){
 		u32 romsize = 0;
 		total_bytes = 0,bytes = 0;
 		const char *emu_bin = "/scfw/ngp.gba";
-		FILE *emu = fopen(emu_bin, "rb");
+		const struct asset *emu = asset_get(emu_bin);
 		if (!emu) {
 			iprintf("Checking %s\n",emu_bin);
 			u_prompt("No NGPGBA found!\n\n");
-			fclose(emu);
 		} else {
-			fseek(emu,0,SEEK_END);
-			romsize = ftell(emu);
+			romsize = emu->file.size;
 			romSize = romsize;
-			fseek(emu, 0, SEEK_SET);
 			iprintf("Loading NGPGBA\n\n");
-			FlashROM(path,pathlen,emu,romSize,false);
 			struct ngp_h head;
 			//
 			char ngp_deps[64];
+			if (!strcasecmp(path + pathlen - 4, ".ngc"))
+				strcpy(ngp_deps,"/scfw/[BIOS]ngp_color.rom");
+			if (!strcasecmp(path + pathlen - 4, ".ngp"))
+				strcpy(ngp_deps,"/scfw/[BIOS]ngp_og.rom");
+			const char *bundle_inputs[] = { emu_bin, ngp_deps };
+			bool bundled = settings.ngp_bios && LoadBundle("ngp", path, bundle_inputs, 2);
+			if (!bundled)
+				FlashCore(emu, romSize);
 			const char *output_path;
-			FILE *out_f0, *out_f1;
-			if (settings.ngp_bios) {
-				if (!strcasecmp(path + pathlen - 4, ".ngc"))
-					strcpy(ngp_deps,"/scfw/[BIOS]ngp_color.rom");
-				if (!strcasecmp(path + pathlen - 4, ".ngp"))
-					strcpy(ngp_deps,"/scfw/[BIOS]ngp_og.rom");
+			FILE *out_f0;
+			if (settings.ngp_bios && !bundled) {
 				output_path = "/scfw/ngpgba_0.dat";
 				iprintf("... PLEASE WAIT ...\n\n");
 				ngp_f(ngp_deps, &head, output_path);
@@ -1612,13 +1987,14 @@ void selectFile(char *path) {
 				romSize += romsize;
 				fseek(out_f0, 0, SEEK_SET);
 				FlashROM(path,pathlen,out_f0,romSize,false);
-				out_f1 = fopen(ngp_deps, "rb");
-				fseek(out_f1, 0, SEEK_END);
-				romsize = ftell(out_f1);
+				fclose(out_f0);
+				const struct asset *bios = asset_get(ngp_deps);
+				romsize = bios ? bios->file.size : 0;
 				romSize += romsize;
-				fseek(out_f1, 0, SEEK_SET);
 				iprintf("Loading NGPGBA BIOS:\n\n");
-				FlashROM(path,pathlen,out_f1,romSize,false);
+				if (bios)
+					FlashAsset(bios, romSize);
+				StoreBundle("ngp", path, bundle_inputs, 2);
 			}
 			//BIOS FIRST THEN THIS
 			head.id = u32conv("PGN") | (0x1A << 24);
@@ -1659,9 +2035,6 @@ void selectFile(char *path) {
 			FlashROM(path,pathlen,rom,romSize,true);
 			fclose(rom);
 			fclose(out_h);
-			fclose(out_f1);
-			fclose(out_f0);
-			fclose(emu);
 			L_Seq(path);
 		}
 	} else if (pathlen > 4 && !strcasecmp(path + pathlen - 4, ".txt")) {
@@ -1672,18 +2045,15 @@ void selectFile(char *path) {
 			txt_bin = "/scfw/txt_s.gba";
 		else
 			txt_bin = "/scfw/txt.gba";
-		FILE *txt = fopen(txt_bin, "rb");
+		const struct asset *txt = asset_get(txt_bin);
 		if (!txt) {
 			iprintf("Checking %s\n",txt_bin);
 			u_prompt("No eBook ROM found!\n\n");
-			fclose(txt);
 		} else {
-			fseek(txt,0,SEEK_END);
-			romsize = ftell(txt);
+			romsize = txt->file.size;
 			romSize = romsize;
-			fseek(txt, 0, SEEK_SET);
 			iprintf("Loading eBook reader \n\n");
-			FlashROM(path,pathlen,txt,romSize,false);
+			FlashCore(txt, romSize);
 			FILE *rom = fopen(path, "rb");
 			fseek(rom, 0, SEEK_END);
 			romsize = ftell(rom);
@@ -1692,26 +2062,22 @@ void selectFile(char *path) {
 			iprintf("Loading txt file:\n\n");
 			FlashROM(path,pathlen,rom,romSize,true);
 			fclose(rom);
-			fclose(txt);
 			L_Seq(path);
 		}
 	} else if ((pathlen > 4 && !strcasecmp(path + pathlen - 4, ".mpa")) || (pathlen > 5 && !strcasecmp(path + pathlen - 5, ".mpac"))){
 		u32 romsize = 0;
 		total_bytes = 0,bytes = 0;
 		const char *mpa_bin = "/scfw/mpa.gba";
-		FILE *mpa = fopen(mpa_bin, "rb");
+		const struct asset *mpa = asset_get(mpa_bin);
 		FILE *out_h;
 		if (!mpa) {
 			iprintf("Checking %s\n",mpa_bin);
 			u_prompt("No Music Player Advance found!\n\n");
-			fclose(mpa);
 		} else {
-			fseek(mpa,0,SEEK_END);
-			romsize = ftell(mpa);
+			romsize = mpa->file.size;
 			romSize = romsize;
-			fseek(mpa, 0, SEEK_SET);
 			iprintf("Loading Music Player Advance \n\n");
-			FlashROM(path,pathlen,mpa,romSize,false);
+			FlashCore(mpa, romSize);
 			if(!strcasecmp(path + pathlen - 4, ".mpa")){
 				//test
 				struct mpa2_h head0;
@@ -1734,25 +2100,21 @@ void selectFile(char *path) {
 			fclose(rom);
 			if(!strcasecmp(path + pathlen - 4, ".mpa"))
 				fclose(out_h);
-			fclose(mpa);
 			L_Seq(path);
 		}
 	} else if (pathlen > 4 && (!strcasecmp(path + pathlen - 4, ".col") && settings.CoG_prio)){
 		u32 romsize = 0;
 		total_bytes = 0,bytes = 0;
 		const char *emu_bin = "/scfw/cog.gba";
-		FILE *emu = fopen(emu_bin, "rb");
+		const struct asset *emu = asset_get(emu_bin);
 		if (!emu) {
 			iprintf("Checking %s\n",emu_bin);
 			u_prompt("CoG not found!\n\n");
-			fclose(emu);
 		} else {
-			fseek(emu,0,SEEK_END);
-			romsize = ftell(emu);
+			romsize = emu->file.size;
 			romSize = romsize;
-			fseek(emu, 0, SEEK_SET);
 			iprintf("Loading CoG\n\n");
-			FlashROM(path,pathlen,emu,romSize,false);
+			FlashCore(emu, romSize);
 			struct CoG_h header;
 			header.pad[0] = 0;
 			FILE *rom = fopen(path, "rb");
@@ -1778,33 +2140,32 @@ void selectFile(char *path) {
 			FlashROM(path,pathlen,rom,romSize,true);
 			fclose(rom);
 			fclose(out_h);
-			fclose(emu);
 			L_Seq(path);
 		}
 	} else if (pathlen > 4 && (!strcasecmp(path + pathlen - 4, ".col") && !settings.CoG_prio)){
 		u32 romsize = 0;
 		total_bytes = 0,bytes = 0;
 		const char *emu_bin = "/scfw/cologne.gba";
-		FILE *emu = fopen(emu_bin, "rb");
+		const struct asset *emu = asset_get(emu_bin);
 		if (!emu) {
 			iprintf("Checking %s\n",emu_bin);
 			u_prompt("No Cologne found!\n\n");
-			fclose(emu);
 		} else {
-			fseek(emu,0,SEEK_END);
-			romsize = ftell(emu);
+			romsize = emu->file.size;
 			romSize = romsize;
-			fseek(emu, 0, SEEK_SET);
 			iprintf("Loading Cologne\n\n");
-			FlashROM(path,pathlen,emu,romSize,false);
 			struct smsa_h head;
 			char cologne_deps[64];
 			strcpy(cologne_deps,"/scfw/[BIOS].col");
+			const char *bundle_inputs[] = { emu_bin, cologne_deps };
+			bool bundled = LoadBundle("cologne", path, bundle_inputs, 2);
+			if (!bundled)
+				FlashCore(emu, romSize);
 			const char *output_path;
 			output_path = "/scfw/col_0.dat";
-			iprintf("... PLEASE WAIT ...\n\n");
-			FILE *out_f0, *out_f1;
-			if (!settings.CoG_prio) {
+			FILE *out_f0;
+			if (!settings.CoG_prio && !bundled) {
+				iprintf("... PLEASE WAIT ...\n\n");
 				smsa_f(cologne_deps, &head, output_path, "LOC");
 				out_f0 = fopen(output_path, "rb");
 				fseek(out_f0,0,SEEK_END);
@@ -1812,13 +2173,14 @@ void selectFile(char *path) {
 				romSize += romsize;
 				fseek(out_f0, 0, SEEK_SET);
 				FlashROM(path,pathlen,out_f0,romSize,false);
-				out_f1 = fopen(cologne_deps, "rb");
-				fseek(out_f1, 0, SEEK_END);
-				romsize = ftell(out_f1);
+				fclose(out_f0);
+				const struct asset *bios = asset_get(cologne_deps);
+				romsize = bios ? bios->file.size : 0;
 				romSize += romsize;
-				fseek(out_f1, 0, SEEK_SET);
 				iprintf("Loading Cologne BIOS:\n\n");
-				FlashROM(path,pathlen,out_f1,romSize,false);
+				if (bios)
+					FlashAsset(bios, romSize);
+				StoreBundle("cologne", path, bundle_inputs, 2);
 			}
 			//Flash COL ROM
 			head.id = u32conv("LOC") | (0x1A << 24);
@@ -1863,9 +2225,6 @@ void selectFile(char *path) {
 			FlashROM(path,pathlen,rom,romSize,true);
 			fclose(rom);
 			fclose(out_h);
-			fclose(out_f1);
-			fclose(out_f0);
-			fclose(emu);
 			L_Seq(path);
 		}
 	} else {
@@ -1873,72 +2232,560 @@ void selectFile(char *path) {
 	}
 }
 
-void change_settings(char *path) {
-	for (int cursor = 0;;) {
+// Several games appended behind one emulator, which then offers them in its
+// own menu. Marked in the browser and built with SELECT+START.
+#define COMPILATION_MAX 64
+#define COMPILATION_PATH_MAX 256
+// Stops short of the emulator stash and what the kernel keeps after it
+#define COMPILATION_LIMIT 0x01f00000
+
+enum compilation_kind {
+	COMPILATION_NONE,
+	COMPILATION_GOOMBA,
+	COMPILATION_POCKETNES,
+	COMPILATION_SMSADVANCE,
+};
+
+EWRAM_BSS static char compilation[COMPILATION_MAX][COMPILATION_PATH_MAX];
+static u32 compilation_len;
+static enum compilation_kind compilation_kind;
+
+static enum compilation_kind compilation_kind_of(const char *path) {
+	u32 pathlen = strlen(path);
+	if ((pathlen > 3 && !strcasecmp(path + pathlen - 3, ".gb")) || (pathlen > 4 && !strcasecmp(path + pathlen - 4, ".gbc")))
+		return COMPILATION_GOOMBA;
+	if (pathlen > 4 && !strcasecmp(path + pathlen - 4, ".nes"))
+		return COMPILATION_POCKETNES;
+	if ((pathlen > 4 && !strcasecmp(path + pathlen - 4, ".sms")) || (pathlen > 3 && !strcasecmp(path + pathlen - 3, ".gg"))
+	    || (pathlen > 3 && !strcasecmp(path + pathlen - 3, ".sg")))
+		return COMPILATION_SMSADVANCE;
+	return COMPILATION_NONE;
+}
+
+// Marks a game, or unmarks it if it already was. False if it can't go in.
+bool compilation_toggle(const char *path) {
+	for (u32 i = 0; i < compilation_len; ++i) {
+		if (!strcmp(compilation[i], path)) {
+			memmove(compilation[i], compilation[i + 1], (compilation_len - i - 1) * COMPILATION_PATH_MAX);
+			if (!--compilation_len)
+				compilation_kind = COMPILATION_NONE;
+			return true;
+		}
+	}
+	enum compilation_kind kind = compilation_kind_of(path);
+	if (kind == COMPILATION_NONE || (compilation_len && kind != compilation_kind)
+	    || compilation_len == COMPILATION_MAX || strlen(path) >= COMPILATION_PATH_MAX)
+		return false;
+	strcpy(compilation[compilation_len++], path);
+	compilation_kind = kind;
+	return true;
+}
+
+// Marks every game in a folder that the first marked game's emulator runs
+u32 compilation_add_dir(const char *dir_path) {
+	char path[PATH_MAX];
+	u32 added = 0;
+	DIR *dir = opendir(dir_path);
+	if (!dir)
+		return 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		if (dirent->d_type == DT_DIR || dirent->d_name[0] == '.')
+			continue;
+		char *ptr = stpcpy(path, dir_path);
+		if (ptr[-1] != '/')
+			ptr = stpcpy(ptr, "/");
+		stpcpy(ptr, dirent->d_name);
+		bool marked = false;
+		for (u32 i = 0; i < compilation_len && !marked; ++i)
+			marked = !strcmp(compilation[i], path);
+		if (!marked && compilation_toggle(path))
+			++added;
+	}
+	closedir(dir);
+	return added;
+}
+
+// Copies a header made in memory into the image
+static void FlashBytes(const void *data, u32 size) {
+	memcpy(filebuf, data, size);
+	sc_mode(SC_RAM_RW);
+	DMA_Copy(3, filebuf, &GBA_ROM[total_bytes >> 2], DMA32 | (size + 3) >> 2);
+	sc_mode(SC_MEDIA);
+	total_bytes += size;
+}
+
+// Streams the emulator once, then a header and ROM for each marked game
+// that fits. The save goes with the compilation, not any one game.
+void build_compilation() {
+	const char *emu_bin = "/scfw/nes.gba";
+	char path[] = "/scfw/compilation.nes";
+	if (compilation_kind == COMPILATION_GOOMBA) {
+		emu_bin = "/scfw/gbc.gba";
+		strcpy(path, "/scfw/compilation.gbc");
+	} else if (compilation_kind == COMPILATION_SMSADVANCE) {
+		emu_bin = "/scfw/smsa.gba";
+		strcpy(path, "/scfw/compilation.sms");
+	}
+	const struct asset *emu = asset_get(emu_bin);
+	if (!emu) {
+		iprintf("Checking %s\n", emu_bin);
+		u_prompt("Emulator not found!\n\n");
+		return;
+	}
+
+	union {
+		struct pnes_h pnes;
+		struct smsa_h smsa;
+	} head;
+	u32 head_size = compilation_kind == COMPILATION_POCKETNES ? sizeof head.pnes
+		: compilation_kind == COMPILATION_SMSADVANCE ? sizeof head.smsa : 0;
+
+	// Picks the games before anything is thrown away, so a build with
+	// none left leaves the resident image and the launch log alone.
+	// Each game starts where the last ended and SDRAM takes whole words,
+	// so a size that isn't one would lose its tail to the next header.
+	u32 sizes[COMPILATION_MAX];
+	u32 end = emu->file.size, games = 0;
+	for (u32 i = 0; i < compilation_len; ++i) {
+		struct stat st;
+		sizes[i] = 0;
+		if (stat(compilation[i], &st) || !st.st_size || (st.st_size & 3)
+		    || end + head_size + st.st_size > COMPILATION_LIMIT)
+			continue;
+		FILE *rom = fopen(compilation[i], "rb");
+		if (!rom)
+			continue;
+		fclose(rom);
+		sizes[i] = st.st_size;
+		end += head_size + st.st_size;
+		++games;
+	}
+	if (games < compilation_len)
+		iprintf("%lu of %lu games fit\n", games, compilation_len);
+	if (!games) {
+		u_prompt("Press A to continue\n");
+		return;
+	}
+
+	knownSaveType = RECENT_SAVE_UNKNOWN;
+	autosave_finish();
+	prefetch_cancel();
+	resident_forget();
+	asset_release();
+	launchlog_begin(path);
+	total_bytes = 0, bytes = 0;
+	romSize = emu->file.size;
+	iprintf("Loading %s\n\n", emu_bin);
+	FlashCore(emu, romSize);
+
+	games = 0;
+	for (u32 i = 0; i < compilation_len; ++i) {
+		if (!sizes[i])
+			continue;
+		FILE *rom = fopen(compilation[i], "rb");
+		if (!rom)
+			continue;
+		if (compilation_kind == COMPILATION_POCKETNES)
+			romhead_pnes(&head.pnes, compilation[i], sizes[i]);
+		else if (compilation_kind == COMPILATION_SMSADVANCE)
+			romhead_smsa(&head.smsa, compilation[i], sizes[i]);
+		romSize += head_size + sizes[i];
+		if (head_size)
+			FlashBytes(&head, head_size);
+		iprintf("%lu: %.26s\n\n", ++games, basename(compilation[i]));
+		FlashROM(compilation[i], strlen(compilation[i]), rom, romSize, false);
+		fclose(rom);
+	}
+	FinishROM(path, strlen(path));
+	L_Seq(path);
+}
+
+u32 boot_ticks;
+
+void show_idle() {
+	iprintf("\x1b[2J"
+	        "Background tasks\n\n");
+	idle_print(stdout);
+	iprintf("\n* still running\nB: back\n");
+	do {
+		scanKeys();
+		pressed = keysDownRepeat();
+		VBlankIntrWait();
+	} while (!(pressed & KEY_B));
+}
+
+void show_iostats() {
+	for (;;) {
 		iprintf("\x1b[2J"
-		        "SCFW Kernel v0.5.2-Coleco \nGBA-mode\n\n");
-		
-		iprintf("%cAutosave: %i\n", cursor == 0 ? '>' : ' ', settings.autosave);
-		iprintf("%cSRAM Patch: %i\n", cursor == 1 ? '>' : ' ', settings.sram_patch);
-		iprintf("%cWaitstate Patch: %i\n", cursor == 2 ? '>' : ' ', settings.waitstate_patch);
-		iprintf("%cSoft reset Patch: %i\n", cursor == 3 ? '>' : ' ', settings.soft_reset_patch);
-		iprintf("%cBoot games through BIOS: %i\n", cursor == 4 ? '>' : ' ', settings.biosboot);
-		iprintf("%cAutosave after cold boot: %i\n", cursor == 5 ? '>' : ' ', settings.cold_boot_save);
-		iprintf("%cDrSMS over SMSAdvance: %i\n", cursor == 6 ? '>' : ' ', settings.DrSMS_prio);
-		iprintf("%cCoG over Cologne: %i\n", cursor == 7 ? '>' : ' ', settings.CoG_prio);
-		iprintf("%cRead txt files sideways: %i\n", cursor == 8 ? '>' : ' ', settings.txtmode_s);
-		iprintf("%c[SMSAdvance] Load BIOS: %i\n", cursor == 9 ? '>' : ' ', settings.smsa_bios);
-		iprintf("%c[WasabiGBA] Load BIOS: %i\n", cursor == 10 ? '>' : ' ', settings.wsv_bios);
-		iprintf("%c[NGPGBA] Load BIOS: %i\n", cursor == 11 ? '>' : ' ', settings.ngp_bios);
-		iprintf("%c[SwanGBA] Load BIOS: %i\n", cursor == 12 ? '>' : ' ', settings.bwsc_bios);
-		
+		        "I/O diagnostics\n");
+		iprintf("Boot to menu: %lums\n", systimer_to_ms(boot_ticks));
+		iostats_print(stdout, true);
+		if (fragmented_extents)
+			iprintf("Fragmented (%lu): %.20s\n", fragmented_extents, strrchr(fragmented, '/') + 1);
+		iprintf("A: save to /scfw/iostats.txt\nB: back\n");
+
 		do {
 			scanKeys();
 			pressed = keysDownRepeat();
 			VBlankIntrWait();
+		} while (!(pressed & (KEY_A | KEY_B)));
+
+		if (pressed & KEY_B)
+			break;
+		if (!iostats_dump("/scfw/iostats.txt"))
+			u_prompt("Could not write iostats.txt\nPress A to continue\n");
+	}
+}
+
+#define LIBRARY_ROWS 16
+
+// One system's games, read from the library a page at a time
+static void show_system_games(const struct library_header *header, u32 system) {
+	union paging_index len = { .abs = header->first[system + 1] - header->first[system] };
+	char nicknames[LIBRARY_ROWS][31];
+	struct library_game game;
+	char name[256];
+	bool redraw = true;
+	union paging_index shown = { .abs = 0 };
+
+	for (union paging_index cursor = { .abs = 0 };;) {
+		if (redraw || cursor.page != shown.page) {
+			char title[TEXTMAP_COLUMNS + 1];
+			textmap_clear();
+			siprintf(title, "%s games %d/%d", launchlog_systems[system], 1 + cursor.page,
+			         (union paging_index){ .abs = LIBRARY_ROWS - 1 + len.abs }.page);
+			textmap_put_text(0, title);
+			for (union paging_index i = { .page = cursor.page }; i.abs < len.abs && i.page == cursor.page; ++i.abs) {
+				if (!library_game(header, system, i.abs, &game, name, sizeof name))
+					strcpy(name, "?");
+				dirsort_nickname(nicknames[i.row], name, false);
+				textmap_put_item(2 + i.row, i.abs == cursor.abs ? '>' : ' ', nicknames[i.row]);
+			}
+			redraw = false;
+		} else if (cursor.abs != shown.abs) {
+			textmap_put_item(2 + shown.row, ' ', nicknames[shown.row]);
+			textmap_put_item(2 + cursor.row, '>', nicknames[cursor.row]);
+		}
+		shown = cursor;
+
+		do {
+			VBlankIntrWait();
+			textmap_present();
+			scanKeys();
+			pressed = keysDownRepeat();
+		} while (!(pressed & (KEY_A | KEY_B | KEY_UP | KEY_DOWN | KEY_LEFT | KEY_RIGHT)));
+
+		if (pressed & KEY_A) {
+			char path[PATH_MAX];
+			textmap_release();
+			if (library_game(header, system, cursor.abs, &game, NULL, 0) && library_path(header, &game, path))
+				selectFile(path);
+			else
+				u_prompt("Could not read the library\nPress A to continue\n");
+			redraw = true;
+		}
+		else if (pressed & KEY_B) {
+			break;
+		}
+		else if (pressed & KEY_DOWN) {
+			++cursor.row;
+			if (cursor.abs >= len.abs)
+				cursor.row = 0;
+		}
+		else if (pressed & KEY_UP) {
+			--cursor.row;
+			if (cursor.abs >= len.abs)
+				cursor.row = len.row - 1;
+		}
+		else if (pressed & KEY_LEFT) {
+			--cursor.page;
+			if (cursor.abs < 0) {
+				u32 row = cursor.row;
+				cursor.abs = len.abs - 1;
+				if (row < cursor.row)
+					cursor.row = row;
+			}
+		}
+		else if (pressed & KEY_RIGHT) {
+			++cursor.page;
+			if (cursor.page >= (union paging_index){ .abs = len.abs + LIBRARY_ROWS - 1 }.page)
+				cursor.page = 0;
+			else if (cursor.abs >= len.abs)
+				cursor.row = len.row - 1;
+		}
+	}
+}
+
+// Brings the library up to date, from scratch with full set
+static bool update_library(struct library_header *header, bool full) {
+	library_close();
+	iprintf("\x1b[2J%s game library...\n", full ? "Building" : "Updating");
+	u32 start = systimer_ticks();
+	s32 games = library_refresh(filter_game, full);
+	if (games < 0 || !library_open(header)) {
+		u_prompt("Could not write " LIBRARY_PATH "\nPress A to continue\n");
+		return false;
+	}
+	iprintf("%ld games, took %lums\n", games, systimer_to_ms(systimer_ticks() - start));
+	return true;
+}
+
+// Every game on the card by system, straight from the library index
+void show_library() {
+	struct library_header header;
+	if (!library_open(&header) && !update_library(&header, true))
+		return;
+
+	u8 systems[LAUNCHLOG_SYSTEMS];
+	u32 systems_len = 0;
+	bool redraw = true;
+	int shown = 0;
+
+	for (int cursor = 0;;) {
+		if (redraw) {
+			systems_len = 0;
+			for (u32 system = 0; system < LAUNCHLOG_SYSTEMS; ++system)
+				if (header.first[system + 1] != header.first[system])
+					systems[systems_len++] = system;
+			if (cursor >= systems_len)
+				cursor = 0;
+
+			textmap_clear();
+			textmap_put_text(0, "Games by system");
+			textmap_put_text(TEXTMAP_ROWS - 1, "SELECT: update  START: rebuild");
+			if (!systems_len)
+				textmap_put_text(2, "No games found");
+		}
+		if (redraw || cursor != shown) {
+			// Rows 2 to 18 hold 17 systems, any more go on a second page
+			int top = cursor / (TEXTMAP_ROWS - 3) * (TEXTMAP_ROWS - 3);
+			for (int i = 0; i < TEXTMAP_ROWS - 3; ++i) {
+				char text[TEXTMAP_COLUMNS];
+				text[0] = '\0';
+				if (top + i < systems_len) {
+					u32 system = systems[top + i];
+					siprintf(text, "%-5s %lu", launchlog_systems[system], header.first[system + 1] - header.first[system]);
+				}
+				textmap_put_item(2 + i, top + i == cursor ? '>' : ' ', text);
+			}
+			redraw = false;
+		}
+		shown = cursor;
+
+		do {
+			VBlankIntrWait();
+			textmap_present();
+			scanKeys();
+			pressed = keysDownRepeat();
+		} while (!(pressed & (KEY_A | KEY_B | KEY_SELECT | KEY_START | KEY_UP | KEY_DOWN)));
+
+		if (pressed & KEY_A) {
+			if (systems_len)
+				show_system_games(&header, systems[cursor]);
+			redraw = true;
+		}
+		else if (pressed & KEY_B) {
+			break;
+		}
+		else if (pressed & (KEY_SELECT | KEY_START)) {
+			textmap_release();
+			if (!update_library(&header, pressed & KEY_START))
+				break;
+			redraw = true;
+		}
+		else if (systems_len && (pressed & KEY_UP)) {
+			if (--cursor < 0)
+				cursor = systems_len - 1;
+		}
+		else if (systems_len && (pressed & KEY_DOWN)) {
+			if (++cursor >= systems_len)
+				cursor = 0;
+		}
+	}
+	library_close();
+}
+
+// Starts a recent game, a GBA ROM straight from the sectors it was found in
+static void launch_recent(struct recent_game *game) {
+	// The list is reordered by the launch
+	char path[RECENT_PATH_MAX];
+	strcpy(path, game->path);
+	if (!recent_check(game)) {
+		u_prompt("Game not found, it was taken\noff the list\nPress A to continue\n");
+		return;
+	}
+
+	u32 pathlen = strlen(path);
+	if (pathlen > 4 && !strcasecmp(path + pathlen - 4, ".gba")) {
+		autosave_finish();
+		prefetch_cancel();
+		resident_forget();
+		launchlog_begin(path);
+		romSize = game->file.size;
+		total_bytes = 0, bytes = 0;
+		iprintf("Loading ROM:\n\n");
+		FlashMapped(path, &game->file, game->extents, romSize);
+		knownSaveType = game->save_type;
+		FinishROM(path, pathlen);
+		L_Seq(path);
+	} else {
+		selectFile(path);
+	}
+}
+
+// The recent games list, false if there are none
+bool show_recent() {
+	if (!recent_count())
+		return false;
+
+	char nicknames[RECENT_MAX][31];
+	bool redraw = true;
+	int shown = 0;
+
+	for (int cursor = 0;;) {
+		u32 len = recent_count();
+		if (!len)
+			break;
+		if (redraw) {
+			textmap_clear();
+			textmap_put_text(0, "Recent games");
+			textmap_put_text(TEXTMAP_ROWS - 1, "A: launch  B: browse");
+			for (u32 i = 0; i < len; ++i) {
+				const struct recent_game *game = recent_get(i);
+				const char *name = strrchr(game->path, '/');
+				dirsort_nickname(nicknames[i], name ? name + 1 : game->path, false);
+				textmap_put_item(2 + i, i == cursor ? '>' : ' ', nicknames[i]);
+			}
+			redraw = false;
+		} else if (cursor != shown) {
+			textmap_put_item(2 + shown, ' ', nicknames[shown]);
+			textmap_put_item(2 + cursor, '>', nicknames[cursor]);
+		}
+		shown = cursor;
+
+		do {
+			VBlankIntrWait();
+			textmap_present();
+			scanKeys();
+			pressed = keysDownRepeat();
+			if (!pressed)
+				idle_run(IDLE_FRAME_TICKS);
+		} while (!(pressed & (KEY_A | KEY_B | KEY_START | KEY_UP | KEY_DOWN)));
+
+		if (pressed & (KEY_A | KEY_START)) {
+			textmap_release();
+			launch_recent(recent_get(cursor));
+			if (cursor >= recent_count())
+				cursor = 0;
+			redraw = true;
+		}
+		else if (pressed & KEY_B) {
+			break;
+		}
+		else if (pressed & KEY_UP) {
+			if (--cursor < 0)
+				cursor = len - 1;
+		}
+		else if (pressed & KEY_DOWN) {
+			if (++cursor >= len)
+				cursor = 0;
+		}
+	}
+	textmap_release();
+	return true;
+}
+
+struct setting_item {
+	const char *label;
+	int *value;			// toggled with A, or NULL for an item that opens a page
+	void (*open)();
+};
+
+static const struct setting_item setting_items[] = {
+	{ "Autosave", &settings.autosave },
+	{ "SRAM Patch", &settings.sram_patch },
+	{ "Waitstate Patch", &settings.waitstate_patch },
+	{ "Soft reset Patch", &settings.soft_reset_patch },
+	{ "Boot games through BIOS", &settings.biosboot },
+	{ "Autosave after cold boot", &settings.cold_boot_save },
+	{ "DrSMS over SMSAdvance", &settings.DrSMS_prio },
+	{ "CoG over Cologne", &settings.CoG_prio },
+	{ "Read txt files sideways", &settings.txtmode_s },
+	{ "[SMSAdvance] Load BIOS", &settings.smsa_bios },
+	{ "[WasabiGBA] Load BIOS", &settings.wsv_bios },
+	{ "[NGPGBA] Load BIOS", &settings.ngp_bios },
+	{ "[SwanGBA] Load BIOS", &settings.bwsc_bios },
+	{ "Verify ROM reads (CRC)", &settings.verify_reads },
+	{ "Recent games at boot", &settings.recent_boot },
+	{ "Autoboot last game", &settings.autoboot },
+	{ "Autosave in the background", &settings.deferred_save },
+	{ "Preload highlighted ROM", &settings.prefetch },
+	{ "Cache emulator bundles", &settings.bundle_cache },
+	{ "Use prebuilt images", &settings.prebuilt },
+	{ "Games by system", NULL, show_library },
+	{ "I/O diagnostics", NULL, show_iostats },
+	{ "Background tasks", NULL, show_idle },
+};
+#define SETTING_ITEMS (sizeof setting_items / sizeof *setting_items)
+#define SETTINGS_FIRST_ROW 3
+#define SETTINGS_VISIBLE (TEXTMAP_ROWS - SETTINGS_FIRST_ROW)
+
+static void draw_setting(int item, int top, bool selected) {
+	const struct setting_item *setting = &setting_items[item];
+	char text[TEXTMAP_COLUMNS];
+	char *ptr = stpcpy(text, setting->label);
+	if (setting->value) {
+		ptr = stpcpy(ptr, ": ");
+		*ptr++ = *setting->value ? '1' : '0';
+		*ptr = '\0';
+	}
+	textmap_put_item(SETTINGS_FIRST_ROW + item - top, selected ? '>' : ' ', text);
+}
+
+void change_settings(char *path) {
+	bool redraw = true;
+	int shown = 0;
+	int top = 0;
+
+	for (int cursor = 0;;) {
+		// Scroll when the list doesn't fit below the title
+		int new_top = top;
+		if (cursor < new_top)
+			new_top = cursor;
+		else if (cursor >= new_top + SETTINGS_VISIBLE)
+			new_top = cursor - SETTINGS_VISIBLE + 1;
+
+		if (redraw || new_top != top) {
+			top = new_top;
+			textmap_clear();
+			textmap_put_text(0, "SCFW Kernel v0.5.2-Coleco");
+			textmap_put_text(1, "GBA-mode");
+			for (int i = top; i < SETTING_ITEMS && i < top + SETTINGS_VISIBLE; ++i)
+				draw_setting(i, top, i == cursor);
+			redraw = false;
+		} else if (cursor != shown) {
+			draw_setting(shown, top, false);
+			draw_setting(cursor, top, true);
+		}
+		shown = cursor;
+
+		do {
+			VBlankIntrWait();
+			textmap_present();
+			scanKeys();
+			pressed = keysDownRepeat();
 		} while (!(pressed & (KEY_A | KEY_B | KEY_UP | KEY_DOWN)));
 		
 		if (pressed & KEY_A) {
-			switch (cursor) {
-			case 0:
-				settings.autosave = !settings.autosave;
-				break;
-			case 1: 
-				settings.sram_patch = !settings.sram_patch;
-				break;
-			case 2:
-				settings.waitstate_patch = !settings.waitstate_patch;
-				break;
-			case 3: 
-				settings.soft_reset_patch = !settings.soft_reset_patch;
-				break;
-			case 4:
-				settings.biosboot = !settings.biosboot;
-				break;
-			case 5:
-				settings.cold_boot_save = !settings.cold_boot_save;
-				break;
-			case 6:
-				settings.DrSMS_prio = !settings.DrSMS_prio;
-				break;
-			case 7:
-				settings.CoG_prio = !settings.CoG_prio;
-				break;
-			case 8:
-				settings.txtmode_s = !settings.txtmode_s;
-				break;
-			case 9:
-				settings.smsa_bios = !settings.smsa_bios;
-				break;
-			case 10:
-				settings.wsv_bios = !settings.wsv_bios;
-				break;
-			case 11:
-				settings.ngp_bios = !settings.ngp_bios;
-				break;
-			case 12:
-				settings.bwsc_bios = !settings.bwsc_bios;
-				break;
+			const struct setting_item *setting = &setting_items[cursor];
+			if (setting->value) {
+				*setting->value = !*setting->value;
+				draw_setting(cursor, top, true);
+			} else {
+				textmap_release();
+				setting->open();
+				redraw = true;
 			}
 		}
 		if (pressed & KEY_B) {
@@ -1947,21 +2794,47 @@ void change_settings(char *path) {
 		if (pressed & KEY_UP) {
 			--cursor;
 			if (cursor < 0)
-				cursor += 13;
+				cursor += SETTING_ITEMS;
 		}
 		if (pressed & KEY_DOWN) {
 			++cursor;
-			if (cursor > 12)
-				cursor -= 13;
+			if (cursor >= SETTING_ITEMS)
+				cursor -= SETTING_ITEMS;
 		}
 	}
 	
+	textmap_release();
 	iprintf("Saving settings...\n");
-	FILE *settings_file = fopen("/scfw/settings.bin", "w+b");
-	if (settings_file) {
-		fwrite(&settings, 1, sizeof settings, settings_file);
-		fclose(settings_file);
+	storeSettings();
+	if (!state_commit())
+		u_prompt("Could not write " STATE_PATH "\nPress A to continue\n");
+}
+
+// Goes straight into the last game played, and when the image is still in
+// SDRAM only its save is loaded. Returns if the game couldn't be started.
+static void autoboot() {
+	// The launch rewrites kernel_state
+	char path[STATE_PATH_MAX];
+	strcpy(path, kernel_state.last_played);
+	autobooting = true;
+
+	u32 size;
+	u16 save_type;
+	if (!resident_find(path, &size, &save_type)) {
+		// A compilation only exists while it is in SDRAM
+		struct stat st;
+		if (!stat(path, &st))
+			selectFile(path);
+		autobooting = false;
+		return;
 	}
+	iprintf("Restarting %s\n", path);
+	autosave_finish();
+	launchlog_begin(path);
+	romSize = total_bytes = size;
+	launchlog_totals.save_type = save_type;
+	prepareSave(path, strlen(path));
+	L_Seq(path);
 }
 
 bool has_reset_token() {
@@ -1971,23 +2844,138 @@ bool has_reset_token() {
 	return reset_token == 0xa55aa55a;
 }
 
+#define BROWSER_ROWS 16
+#define DIRENTS_MAX 0x200
+#define SCAN_TICKS_PER_FRAME SYSTIMER_MS(8)	// leaves the rest of the frame for drawing
+#define SCAN_NO_LIMIT 0x7FFFFFFF
+#define FIND_ROW (2 + BROWSER_ROWS)
+#define FIND_MAX 12
+
+// What the letter picker cycles through
+static const char find_letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 -";
+
+EWRAM_DATA static struct dirent_brief dirents[DIRENTS_MAX];
+EWRAM_DATA static u32 dirent_keys[DIRENTS_MAX];
+EWRAM_DATA static u16 dirent_order[DIRENTS_MAX];
+EWRAM_DATA static u16 dirent_scratch[DIRENTS_MAX];
+
+// A directory listing read a little at a time between frames, so the first
+// page shows before a big directory has been read to the end
+struct dir_scan {
+	DIR *dir;
+	union paging_index len;
+	bool overflow;
+	bool done;
+	// While a sorted listing is scanned, only its first page is known. It is
+	// kept sorted as entries arrive and the full sort waits for the end.
+	u16 top[BROWSER_ROWS];
+	u32 top_len;
+	bool top_changed;
+	// Built once the sorted listing is complete, for the letter jumps and the picker
+	struct dirsort_index index;
+};
+
+static void scan_insert_top(struct dir_scan *scan, u16 index) {
+	bool folders_first = settings.sort == SORT_FOLDER_NICKNAME;
+	u32 pos = scan->top_len;
+
+	while (pos && dirsort_compare(dirents, dirent_keys, index, scan->top[pos - 1], folders_first) < 0)
+		--pos;
+	if (pos >= BROWSER_ROWS)
+		return;
+
+	u32 end = scan->top_len < BROWSER_ROWS ? scan->top_len++ : BROWSER_ROWS - 1;
+	memmove(&scan->top[pos + 1], &scan->top[pos], (end - pos) * sizeof *scan->top);
+	scan->top[pos] = index;
+	scan->top_changed = true;
+}
+
+static void scan_entry(struct dir_scan *scan) {
+	u32 off = telldir(scan->dir);
+	struct dirent *dirent = readdir(scan->dir);
+	if (!dirent) {
+		scan->done = true;
+		return;
+	}
+	if (scan->len.abs >= DIRENTS_MAX) {
+		scan->overflow = true;
+		scan->done = true;
+		return;
+	}
+	if ((*filters[settings.filter])(dirent)) {
+		struct dirent_brief *brief = &dirents[scan->len.abs];
+		brief->off = off;
+		brief->isdir = dirent->d_type == DT_DIR;
+		dirsort_nickname(brief->nickname, dirent->d_name, brief->isdir);
+		dirent_keys[scan->len.abs] = dirsort_key(brief->nickname);
+		dirent_order[scan->len.abs] = scan->len.abs;
+		if (settings.sort != SORT_NONE)
+			scan_insert_top(scan, scan->len.abs);
+		++scan->len.abs;
+	}
+}
+
+// Reads entries until the scan ends, the listing has min_len entries, or the time is up
+static void scan_run(struct dir_scan *scan, s32 min_len, u32 ticks) {
+	u32 deadline = systimer_deadline(ticks);
+	if (scan->done)
+		return;
+	while (!scan->done && scan->len.abs < min_len && !systimer_expired(deadline))
+		scan_entry(scan);
+	if (scan->done && settings.sort != SORT_NONE) {
+		bool folders_first = settings.sort == SORT_FOLDER_NICKNAME;
+		dirsort_sort(dirent_order, dirent_scratch, scan->len.abs, dirents, dirent_keys, folders_first);
+		dirsort_index_build(&scan->index, dirent_order, scan->len.abs, dirents, dirent_keys, folders_first);
+	}
+}
+
+// The entries that can be shown so far
+static s32 scan_listed(struct dir_scan *scan) {
+	return settings.sort != SORT_NONE && !scan->done ? scan->top_len : scan->len.abs;
+}
+
+// Indices into dirents, in the order they are listed
+static const u16 *scan_order(struct dir_scan *scan) {
+	return settings.sort != SORT_NONE && !scan->done ? scan->top : dirent_order;
+}
+
+static struct dirent_brief *scan_entry_at(struct dir_scan *scan, s32 abs) {
+	return &dirents[scan_order(scan)[abs]];
+}
+
+// The picker's letter for a character of a nickname, or the first one
+static u32 find_letter_of(char c) {
+	const char *letter = c ? strchr(find_letters, toupper((u8)c)) : NULL;
+	return letter ? letter - find_letters : 0;
+}
+
 int main() {
+	systimer_init();
 	irqInit();
 	irqEnable(IRQ_VBLANK);
 	scanKeys();
 	keysDownRepeat();
 
 	consoleDemoInit();
+	textmap_init();
+	progress_init();
 
 	iprintf("SCFW Kernel v0.5.2-Coleco \nGBA-mode\n\n");
 	
 	*(vu16*) 0x04000204	 = 0x40c0;
+	PROFILE_BEGIN(PROFILE_OVERCLOCK);
 	if (overclock_ewram())
 		iprintf("Overclocked EWRAM\n");
 	else
 		iprintf("Could not overclock EWRAM\n");
+	PROFILE_END(PROFILE_OVERCLOCK);
 
+	PROFILE_BEGIN(PROFILE_SD_STARTUP);
+	u32 sd_start = systimer_ticks();
 	_my_io_scsd.startup();
+	iprintf("SD %s start took %lums\n", _SCSD_warmStarted ? "warm" : "full", systimer_to_ms(systimer_ticks() - sd_start));
+	PROFILE_END(PROFILE_SD_STARTUP);
+	PROFILE_BEGIN(PROFILE_FAT_MOUNT);
 	if (fatMountSimple("fat", &_my_io_scsd)) {
 		iprintf("FAT system initialised\n");
 	} else {
@@ -1995,101 +2983,264 @@ int main() {
 		tryAgain();
 	}
 	chdir("fat:/");
+	fatmap_init(&_my_io_scsd);
+	PROFILE_END(PROFILE_FAT_MOUNT);
 
+	PROFILE_BEGIN(PROFILE_SETTINGS);
 	{
 		iprintf("Loading settings...\n");
-		FILE *settings_file = fopen("/scfw/settings.bin", "rb+");
-		if (settings_file) {
-			iprintf("Reading settings\n");
-			if (fread(&settings, 1, sizeof settings, settings_file) != sizeof settings) {
-					iprintf("Appending new defaults\n");
-					freopen("", "w+b", settings_file);
-					fwrite(&settings, 1, sizeof settings, settings_file);
-			}
-			fclose(settings_file);
+		if (state_load()) {
+			// Settings added since the record was written keep their defaults
+			u32 size = kernel_state.settings_size;
+			memcpy(&settings, kernel_state.settings, size < sizeof settings ? size : sizeof settings);
 		} else {
-			iprintf("Creating settings file\n");
-			settings_file = fopen("/scfw/settings.bin", "wb");
-			if (settings_file) {
-				fwrite(&settings, 1, sizeof settings, settings_file);
-				fclose(settings_file);
+			// Take over the files the state record replaces
+			iprintf("Creating " STATE_PATH "\n");
+			FILE *old = fopen("/scfw/settings.bin", "rb");
+			if (old) {
+				fread(&settings, 1, sizeof settings, old);
+				fclose(old);
+			}
+			old = fopen("/scfw/lastplayed.txt", "rb");
+			if (old) {
+				kernel_state.last_played[fread(kernel_state.last_played, 1, STATE_PATH_MAX - 1, old)] = '\0';
+				fclose(old);
+			}
+			old = fopen("/scfw/lastsaved.txt", "rb");
+			if (old) {
+				kernel_state.last_saved[fread(kernel_state.last_saved, 1, STATE_PATH_MAX - 1, old)] = '\0';
+				fclose(old);
+			}
+			storeSettings();
+			if (state_commit()) {
+				remove("/scfw/settings.bin");
+				remove("/scfw/lastplayed.txt");
+				remove("/scfw/lastsaved.txt");
 			}
 		}
 		iprintf("Settings loaded!\n");
 	}
+	PROFILE_END(PROFILE_SETTINGS);
 
+	PROFILE_BEGIN(PROFILE_AUTOSAVE);
 	if (settings.autosave) {
 		if (settings.cold_boot_save || has_reset_token()) {
-			FILE *lastSaved = fopen("/scfw/lastsaved.txt", "rb");
-			if (lastSaved) {
-				char path[PATH_MAX];
-				path[fread(path, 1, PATH_MAX, lastSaved)] = '\0';
-				saveSram(path);
-			}
+			if (kernel_state.last_saved[0] && settings.deferred_save)
+				autosave_begin(kernel_state.last_saved);
+			else if (kernel_state.last_saved[0])
+				saveSram(kernel_state.last_saved);
 		}
 		else {
 			iprintf("Skipping autosave due to cold boot.\n");
 		}
-		remove("/scfw/lastsaved.txt");
+		// Only written when there was something to clear, a deferred autosave clears it once it is done
+		if (kernel_state.last_saved[0] && !autosave_file) {
+			kernel_state.last_saved[0] = '\0';
+			state_commit();
+		}
+	}
+	PROFILE_END(PROFILE_AUTOSAVE);
+
+	// Holding any key while starting shows the menu instead. The reset token
+	// isn't a reason to autoboot: a soft reset leaves it, and the menu would
+	// then only be reachable by a cold boot.
+	scanKeys();
+	if (settings.autoboot && kernel_state.last_played[0] && !keysHeld())
+		autoboot();
+
+	// Recent games come up before any directory has been read
+	if (settings.recent_boot && recent_count()) {
+		boot_ticks = systimer_ticks();
+		PROFILE_REPORT("boot", PROFILE_BOOT);
+		show_recent();
 	}
 
+	if (!boot_ticks)
+		PROFILE_BEGIN(PROFILE_FIRST_LISTING);
 	for (;;) {
 		char cwd[PATH_MAX];
 		getcwd(cwd, PATH_MAX);
 		u32 cwdlen = strlen(cwd);
-		DIR *dir = opendir(".");
-		EWRAM_DATA static struct dirent_brief dirents[0x200];
-		union paging_index dirents_len;
-		bool dirents_overflow = false;
-		dirents_len.abs = 0;
-		for (;;) {
-			u32 off = telldir(dir);
-			struct dirent *dirent = readdir(dir);
-			if (!dirent)
-				break;
-			if (dirents_len.abs >= 0x200) {
-				dirents_overflow = true;
-				break;
-			}
-			if ((*filters[settings.filter])(dirent)) {
-				dirents[dirents_len.abs].off = off;
-				dirents[dirents_len.abs].isdir = dirent->d_type == DT_DIR;
- 				u32 namelen = strlen(dirent->d_name);
-				if (dirent->d_type == DT_DIR)
-					if (namelen > 27)
-						sprintf(dirents[dirents_len.abs].nickname, "%.20s*%s/", dirent->d_name, dirent->d_name + namelen - 6);
-					else
-						sprintf(dirents[dirents_len.abs].nickname, "%s/", dirent->d_name);
-				else
-					if (namelen > 28)
-						sprintf(dirents[dirents_len.abs].nickname, "%.20s*%s", dirent->d_name, dirent->d_name + namelen - 7);
-					else
-						sprintf(dirents[dirents_len.abs].nickname, "%s", dirent->d_name);
-				++dirents_len.abs;
-			}
-		}
-		if (!dirents_len.abs) {
+		struct dir_scan scan = { .dir = opendir(".") };
+		DIR *dir = scan.dir;
+
+		// Enough for the first page, the rest is read between frames
+		scan_run(&scan, BROWSER_ROWS, SCAN_NO_LIMIT);
+		if (!scan.len.abs) {
 			iprintf("No directory entries!\n");
 			tryAgain();
 		}
-		if (sorts[settings.sort])
-			qsort(dirents, dirents_len.abs, sizeof *dirents, sorts[settings.sort]);
+		union paging_index dirents_len = { .abs = scan_listed(&scan) };
+		if (!boot_ticks) {
+			boot_ticks = systimer_ticks();
+			PROFILE_END(PROFILE_FIRST_LISTING);
+			PROFILE_REPORT("boot", PROFILE_BOOT);
+		}
 
+		bool redraw = true;
+		// The letter picker: the typed prefix, plus the letter being chosen
+		bool finding = false;
+		bool found = false;
+		// SELECT opens the picker when let go, unless it was held for a combo
+		bool select_alone = false;
+		char find[FIND_MAX + 2];
+		u32 find_len = 0;
+		u32 letter = 0;
+		// When the cursor has rested long enough to start a prefetch
+		u32 rest_deadline = systimer_deadline(PREFETCH_DELAY);
+		bool rested = false;
+		union paging_index shown = { .abs = 0 };
 		for (union paging_index cursor = { .abs = 0 };;) {
-			iprintf("\x1b[2J");
-			iprintf("%s\n%d/%d%s\n", cwdlen > 28 ? cwd + cwdlen - 28 : cwd, 1 + cursor.page, (union paging_index){ .abs = 15 + dirents_len.abs }.page, dirents_overflow ? "!" : "");
-
-			for (union paging_index i = { .page = cursor.page }; i.abs < dirents_len.abs && i.page == cursor.page; ++i.abs)
-				iprintf("%c%s\n", i.abs == cursor.abs ? '>' : ' ', dirents[i.abs].nickname);
+			if (cursor.abs != shown.abs) {
+				prefetch_cancel();
+				rest_deadline = systimer_deadline(PREFETCH_DELAY);
+				rested = false;
+			}
+			if (redraw || cursor.page != shown.page) {
+				char header[TEXTMAP_COLUMNS + 1];
+				textmap_clear();
+				textmap_put_text(0, cwdlen > 28 ? cwd + cwdlen - 28 : cwd);
+				siprintf(header, "%d/%d%s", 1 + cursor.page, (union paging_index){ .abs = 15 + dirents_len.abs }.page,
+				         !scan.done ? "..." : scan.overflow ? "!" : "");
+				if (compilation_len)
+					siprintf(header + strlen(header), "  %lu marked", compilation_len);
+				textmap_put_text(1, header);
+				for (union paging_index i = { .page = cursor.page }; i.abs < dirents_len.abs && i.page == cursor.page; ++i.abs)
+					textmap_put_item(2 + i.row, i.abs == cursor.abs ? '>' : ' ', scan_entry_at(&scan, i.abs)->nickname);
+				redraw = false;
+			} else if (cursor.abs != shown.abs) {
+				// Only the rows losing and gaining the marker change
+				textmap_put_item(2 + shown.row, ' ', scan_entry_at(&scan, shown.abs)->nickname);
+				textmap_put_item(2 + cursor.row, '>', scan_entry_at(&scan, cursor.abs)->nickname);
+			}
+			shown = cursor;
+			if (finding) {
+				char line[TEXTMAP_COLUMNS + 1];
+				siprintf(line, "Find: %.*s[%c]%s", (int)find_len, find, find_letters[letter], found ? "" : "  none");
+				textmap_put_text(FIND_ROW, line);
+			}
 
+			u32 released;
 			do {
+				VBlankIntrWait();
+				textmap_present();
 				scanKeys();
 				pressed = keysDownRepeat();
-				VBlankIntrWait();
-			} while (!(pressed & (KEY_A | KEY_B | KEY_START | KEY_UP | KEY_DOWN | KEY_LEFT | KEY_RIGHT | KEY_L | KEY_R)));
+				released = keysUp();
+				// The listing comes first, background tasks get the idle time once it is read
+				if (!pressed && scan.done) {
+					if (settings.prefetch && !rested && !finding && systimer_expired(rest_deadline)) {
+						const struct dirent_brief *entry = scan_entry_at(&scan, cursor.abs);
+						rested = true;
+						if (!entry->isdir) {
+							char path[PATH_MAX];
+							seekdir(dir, entry->off);
+							char *ptr = stpcpy(path, cwd);
+							if (ptr[-1] != '/')
+								ptr = stpcpy(ptr, "/");
+							stpcpy(ptr, readdir(dir)->d_name);
+							prefetch_start(path);
+						}
+					}
+					idle_run(IDLE_FRAME_TICKS);
+				}
+				else if (!pressed) {
+					// Keep reading in the idle part of the frame
+					s32 old_len = scan.len.abs;
+					scan.top_changed = false;
+					scan_run(&scan, DIRENTS_MAX, SCAN_TICKS_PER_FRAME);
+					dirents_len.abs = scan_listed(&scan);
+					// The page on screen changed if it wasn't full, the first page of a sorted listing got a new
+					// entry, or the scan ended and the page count is final
+					if ((scan.len.abs != old_len && old_len < (cursor.page + 1) * BROWSER_ROWS) || scan.top_changed || scan.done)
+						redraw = true;
+				}
+			} while (!(pressed & (KEY_A | KEY_B | KEY_SELECT | KEY_START | KEY_UP | KEY_DOWN | KEY_LEFT | KEY_RIGHT | KEY_L | KEY_R))
+			         && !(released & KEY_SELECT) && !redraw);
+			if (redraw)
+				continue;
+
+			// SELECT with L or R changes the listing itself, with A, B or START it marks games for a compilation.
+			// On its own it opens the letter picker once let go, and closes it when pressed.
+			if (keysDown() & KEY_SELECT)
+				select_alone = !finding;
+			if (pressed & ~KEY_SELECT)
+				select_alone = false;
+			bool picking = (released & KEY_SELECT) && select_alone;
+			if (released & KEY_SELECT)
+				select_alone = false;
+			bool relist = !finding && (pressed & (KEY_L | KEY_R)) && (keysHeld() & KEY_SELECT);
+			bool marking = !finding && (pressed & (KEY_A | KEY_B | KEY_START)) && (keysHeld() & KEY_SELECT);
+			if (relist || marking || (!finding && (pressed & (KEY_A | KEY_B | KEY_START)))) {
+				// These may print through the console
+				textmap_release();
+				redraw = true;
+			}
 
-			if (pressed & KEY_A) {
-				seekdir(dir, dirents[cursor.abs].off);
+			if (relist) {
+				if (pressed & KEY_L) {
+					++settings.sort;
+					if (settings.sort >= SORT_LEN)
+						settings.sort -= SORT_LEN;
+				} else {
+					++settings.filter;
+					if (settings.filter >= FILTER_LEN)
+						settings.filter -= FILTER_LEN;
+				}
+				break;
+			}
+			else if (marking) {
+				finding = false;
+				if (pressed & KEY_A) {
+					long resume = telldir(dir);
+					seekdir(dir, scan_entry_at(&scan, cursor.abs)->off);
+					struct dirent *dirent = readdir(dir);
+					char path[PATH_MAX];
+					char *ptr = stpcpy(path, cwd);
+					if (ptr[-1] != '/')
+						ptr = stpcpy(ptr, "/");
+					stpcpy(ptr, dirent->d_name);
+					bool isdir = dirent->d_type == DT_DIR;
+					seekdir(dir, resume);
+					if (isdir ? !compilation_add_dir(path) : !compilation_toggle(path))
+						u_prompt("Only GB/GBC, NES or SMS/GG/SG\ngames go in a compilation, all\nfor the same emulator, up to 64\n\nPress A to continue\n");
+				}
+				else if (pressed & KEY_B) {
+					compilation_len = 0;
+					compilation_kind = COMPILATION_NONE;
+				}
+				else if (compilation_len) {
+					build_compilation();
+				}
+			}
+			else if (finding) {
+				if (pressed & KEY_UP)
+					letter = letter ? letter - 1 : sizeof find_letters - 2;
+				else if (pressed & KEY_DOWN)
+					letter = letter < sizeof find_letters - 2 ? letter + 1 : 0;
+				else if (pressed & (KEY_A | KEY_RIGHT)) {
+					if (found && find_len < FIND_MAX) {
+						find[find_len++] = find_letters[letter];
+						// Offer the next letter of the entry found, so the cursor stays put
+						letter = find_letter_of(scan_entry_at(&scan, cursor.abs)->nickname[find_len]);
+					}
+				}
+				else if (pressed & (KEY_B | KEY_LEFT)) {
+					if (find_len)
+						letter = find_letter_of(find[--find_len]);
+					else
+						finding = false;
+				}
+				else if ((keysDown() & KEY_SELECT) || (pressed & KEY_START))
+					finding = false;
+
+				if (!finding)
+					redraw = true;
+			}
+			else if (pressed & KEY_A) {
+				// The scan may still be running on the same handle
+				long resume = telldir(dir);
+				seekdir(dir, scan_entry_at(&scan, cursor.abs)->off);
 				struct dirent *dirent = readdir(dir);
 				if (dirent->d_type == DT_DIR) {
 					chdir(dirent->d_name);
@@ -2101,6 +3252,7 @@ int main() {
 						ptr = stpcpy(ptr, "/");
 					ptr = stpcpy(ptr, dirent->d_name);
 					selectFile(path);
+					seekdir(dir, resume);
 				}
 			}
 			else if (pressed & KEY_B) {
@@ -2108,25 +3260,24 @@ int main() {
 					change_settings(NULL);
 				break;
 			}
-			else if (pressed & KEY_SELECT) {
-				if (chdir(".."))
-					//ShowRTC();
-				break;
-			}
 			else if (pressed & KEY_START) {
-				FILE *lastPlayed = fopen("/scfw/lastplayed.txt", "rb");
-				if (lastPlayed) {
-					char path[PATH_MAX];
-					path[fread(path, 1, PATH_MAX, lastPlayed)] = '\0';
-					fclose(lastPlayed);
-					selectFile(path);
-				} else {
-					iprintf("Could not open last played.\n");
-					do {
-						scanKeys();
-						pressed = keysDownRepeat();
-						VBlankIntrWait();
-					} while (!(pressed & KEY_A));
+				// With no recent list yet, relaunch the last game played
+				if (!show_recent()) {
+					// A compilation only exists while it is in SDRAM, only autoboot restarts it
+					struct stat st;
+					if (kernel_state.last_played[0] && !stat(kernel_state.last_played, &st)) {
+						// The launch rewrites kernel_state
+						char path[STATE_PATH_MAX];
+						strcpy(path, kernel_state.last_played);
+						selectFile(path);
+					} else {
+						iprintf("Could not open last played.\n");
+						do {
+							scanKeys();
+							pressed = keysDownRepeat();
+							VBlankIntrWait();
+						} while (!(pressed & KEY_A));
+					}
 				}
 			}
 			else if (pressed & KEY_DOWN) {
@@ -2157,18 +3308,25 @@ int main() {
 				}
 			}
 			else if (pressed & KEY_L) {
-				++settings.sort;
-				if (settings.sort >= SORT_LEN)
-					settings.sort -= SORT_LEN;
-
-				break;
+				cursor.abs = dirsort_prev_letter(&scan.index, scan_order(&scan), dirents_len.abs, dirent_keys, cursor.abs);
 			}
 			else if (pressed & KEY_R) {
-				++settings.filter;
-				if (settings.filter >= FILTER_LEN)
-					settings.filter -= FILTER_LEN;
+				cursor.abs = dirsort_next_letter(&scan.index, scan_order(&scan), dirents_len.abs, dirent_keys, cursor.abs);
+			}
+			else if (picking) {
+				finding = true;
+				find_len = 0;
+				letter = find_letter_of(scan_entry_at(&scan, cursor.abs)->nickname[0]);
+			}
 
-				break;
+			if (finding) {
+				// Move to the first entry matching what is typed so far and the letter being chosen
+				find[find_len] = find_letters[letter];
+				find[find_len + 1] = '\0';
+				s32 pos = dirsort_find(&scan.index, scan_order(&scan), dirents_len.abs, dirents, dirent_keys, find);
+				found = pos >= 0;
+				if (found)
+					cursor.abs = pos;
 			}
 		}
 		closedir(dir);
@@ -34,9 +34,18 @@
 #include "my_io_scsd.h"
 #include "my_io_sd_common.h"
 #include "my_io_sc_common.h"
+#include "systimer.h"
 
 #define printf(...)
 
+#ifdef SCFW_IOSTATS
+#define STAT_ADD(field, n) (_SCSD_stats.field += (n))
+#define STAT_TICKS() systimer_ticks()
+#else
+#define STAT_ADD(field, n) ((void)(n))
+#define STAT_TICKS() 0
+#endif
+
 //---------------------------------------------------------------
 // SCSD register addresses
 #define REG_SCSD_CMD	        (*(vu16*)(0x09800000))
@@ -44,6 +53,7 @@
 	/* bit 7: command bit to write 		*/
 
 #define REG_SCSD_DATAWRITE	    (*(vu16*)(0x09000000))
+#define REG_SCSD_DATAWRITE_32	(*(vu32*)(0x09000000))
 #define REG_SCSD_DATAREAD	    (*(vu16*)(0x09100000))
 #define REG_SCSD_DATAREAD_32	(*(vu32*)(0x09100000))
 // abuse misaligned loads to rotate by 16 bits for free
@@ -64,20 +74,36 @@
 #define NUM_STARTUP_CLOCKS 100	// Number of empty (0xFF when sending) bytes to send/receive to/from the card
 #define TRANSMIT_TIMEOUT 100000 // Time to wait for the SC to respond to transmit or receive requests
 #define RESPONSE_TIMEOUT 256	// Number of clocks sent to the SD card before giving up
-#define BUSY_WAIT_TIMEOUT 500000
-#define WRITE_TIMEOUT	3000	// Time to wait for the card to finish writing
+// Deadlines are measured with the system timer, so they hold whatever the waitstates
+#define COMMAND_TIMEOUT	SYSTIMER_MS(100)	// Time to wait for the CMD line to go ready or for a response
+#define READ_TIMEOUT	SYSTIMER_MS(250)	// Time to wait for a data block, the spec allows 100ms
+#define WRITE_TIMEOUT	SYSTIMER_MS(500)	// Time to wait for the card to finish writing, 250ms for SDSC, 500ms for SDHC
+#define POLLS_PER_CHECK 0x100	// Busy polls between reads of the timer
+#define READ_RETRIES	3	// Times a failed sector is re-read before giving up
+#define RESELECT_AFTER	2	// Failures in a row before the card is re-selected
 
 #define BYTES_PER_READ 512
+// SET_BLOCK_COUNT failures in a row before the driver stops trying it for the session
+#define CMD23_MAX_REJECTS 4
 
 //---------------------------------------------------------------
 // Variables required for tracking SD state
 u32 _SCSD_relativeCardAddress = 0;	// Preshifted Relative Card Address
 bool isSDHC;
+bool _SCSD_cmd23Supported = false;
+static u32 cmd23RejectsInARow = 0;
+bool _SCSD_verifyReads = false;
+bool _SCSD_warmStarted = false;
+SCSD_STATS _SCSD_stats;
 //---------------------------------------------------------------
 // Internal SC SD functions
 
-extern bool _SCSD_readData_s (u8 *buf);
-extern bool _SCSD_writeData_s (u8 *data, u16* crc);
+extern bool _SCSD_readData_s (u8 *buf, u8 *crc);
+extern int _SCSD_writeData_s (u8 *data, u16* crc);
+#define SCSD_WRITE_NOT_READY	0	// no free buffer yet, nothing was sent
+#define SCSD_WRITE_DONE		1
+#define SCSD_WRITE_BUSY		2	// block sent, card still receiving it
+extern void _SCSD_crc16_s (const u32 *data, u8 *crc);
 
 void _SCSD_unlock (void) {
 	_SC_changeMode (SC_MODE_MEDIA);	
@@ -93,7 +119,8 @@ bool _SCSD_sendCommand (u8 command, u32 argument) {
 	int length = 6;
 	u16 dataByte;
 	int curBit;
-	int i;
+	u32 polls = 0;
+	u32 deadline;
 
 	*tempDataPtr++ = command | 0x40;	//Byte1:最高位为01，剩下的6bit是command
 	*tempDataPtr++ = argument>>24;
@@ -102,11 +129,18 @@ bool _SCSD_sendCommand (u8 command, u32 argument) {
 	*tempDataPtr++ = argument;			//剩下的4byte是命令
 	*tempDataPtr = _SD_CRC7 (databuff, 5);	//最后的是进行CRC的校验
 
-	i = BUSY_WAIT_TIMEOUT;
-	while (((REG_SCSD_CMD & 0x01) == 0) && (--i));
-	if (i == 0) {
-		return false;
+	u32 start = STAT_TICKS();
+	deadline = systimer_deadline(COMMAND_TIMEOUT);
+	while ((REG_SCSD_CMD & 0x01) == 0) {
+		if ((++polls % POLLS_PER_CHECK) == 0 && systimer_expired(deadline)) {
+			STAT_ADD(busyWaitLoops, polls);
+			STAT_ADD(timeouts, 1);
+			return false;
+		}
 	}
+	STAT_ADD(busyWaitLoops, polls);
+	STAT_ADD(busyWaitTicks, STAT_TICKS() - start);
+	STAT_ADD(commands[command & 0x3F], 1);
 		
 	dataByte = REG_SCSD_CMD;
 
@@ -128,16 +162,27 @@ bool _SCSD_getResponse (u8* dest, u32 length) {
 	u32 i;	
 	int dataByte;
 	int numBits = length * 8;
+	u32 polls = 0;
+	bool timedOut = false;
 	
 	// Wait for the card to be non-busy
-	i = BUSY_WAIT_TIMEOUT;
-	while (((REG_SCSD_CMD & 0x01) != 0) && (--i));
+	u32 start = STAT_TICKS();
+	u32 deadline = systimer_deadline(COMMAND_TIMEOUT);
+	while ((REG_SCSD_CMD & 0x01) != 0) {
+		if ((++polls % POLLS_PER_CHECK) == 0 && systimer_expired(deadline)) {
+			timedOut = true;
+			break;
+		}
+	}
+	STAT_ADD(busyWaitLoops, polls);
+	STAT_ADD(busyWaitTicks, STAT_TICKS() - start);
 	if (dest == NULL) {
 		return true;
 	}
 	
-	if (i == 0) {
+	if (timedOut) {
 		// Still busy after the timeout has passed
+		STAT_ADD(timeouts, 1);
 		return false;
 	}
 	
@@ -200,6 +245,101 @@ bool _SCSD_cmd_17byte_response_my (u8* responseBuffer, u8 command, u32 data) {
 }
 
 
+// Reads a short data block (such as the SCR) that doesn't fill a whole sector
+bool _SCSD_readDataShort (u8* dest, u32 length) {
+	register u32 temp;
+	u32 i;
+	u32 polls = 0;
+	u32 deadline = systimer_deadline(READ_TIMEOUT);
+
+	while (REG_SCSD_DATAREAD & SCSD_STS_BUSY) {
+		if ((++polls % POLLS_PER_CHECK) == 0 && systimer_expired(deadline)) {
+			return false;
+		}
+	}
+
+	for (i = 0; i < length; i += 2) {
+		temp = REG_SCSD_DATAREAD_32_ROT16;
+		temp = REG_SCSD_DATAREAD_32_ROT16;
+		*dest++ = (u8)temp;
+		*dest++ = (u8)(temp >> 8);
+	}
+
+	// Skip the CRC and the end bit
+	for (i = 0; i < 8; i++) {
+		temp = REG_SCSD_DATAREAD_32;
+	}
+	temp = REG_SCSD_DATAREAD;
+
+	return true;
+}
+
+// Checks the SCR to see if the card accepts SET_BLOCK_COUNT before a multi-block read
+void _SCSD_probeCmd23 (void) {
+	u8 responseBuffer[6];
+	u8 scr[SCR_LENGTH];
+
+	_SCSD_cmd23Supported = false;
+	cmd23RejectsInARow = 0;
+
+	if (!_SCSD_cmd_6byte_response_my (responseBuffer, APP_CMD, _SCSD_relativeCardAddress) || responseBuffer[0] != APP_CMD) {
+		return;
+	}
+	if (!_SCSD_sendCommand (SEND_SCR, 0)) {
+		return;
+	}
+	if (!_SCSD_readDataShort (scr, SCR_LENGTH)) {
+		return;
+	}
+	_SCSD_sendClocks (64);
+
+	_SCSD_cmd23Supported = (scr[3] & SCR_CMD23_SUPPORT) != 0;
+}
+
+// Picks the card up in the state the SuperCard firmware left it in, which
+// saves the whole power up sequence. Fails if the card isn't usable as is.
+bool _SCSD_warmStart (void) {
+	u8 responseBuffer[17];
+	u32 rca;
+
+	_SCSD_enable_lite();
+	_SCSD_sendClocks (NUM_STARTUP_CLOCKS);
+
+	// The firmware's address isn't known, so deselect the card and have it publish a new one
+	_SCSD_sendCommand (SELECT_CARD, 0);
+	_SCSD_sendClocks (64);
+	if (!_SCSD_cmd_6byte_response_my (responseBuffer, SEND_RELATIVE_ADDR, 0) || responseBuffer[0] != SEND_RELATIVE_ADDR) {
+		return false;
+	}
+	rca = (responseBuffer[1] << 24) | (responseBuffer[2] << 16);
+
+	// CSD version 2.0 cards are block addressed
+	if (!_SCSD_cmd_17byte_response_my (responseBuffer, SEND_CSD, rca) || responseBuffer[0] != 0x3F) {
+		return false;
+	}
+	isSDHC = (responseBuffer[1] >> 6) == 1;
+
+	if (!_SCSD_cmd_6byte_response_my (responseBuffer, SELECT_CARD, rca) || responseBuffer[0] != SELECT_CARD) {
+		return false;
+	}
+	_SCSD_relativeCardAddress = rca;
+
+	// Don't rely on the firmware's bus width and block length
+	if (!_SCSD_cmd_6byte_response_my (responseBuffer, APP_CMD, rca) || responseBuffer[0] != APP_CMD
+		|| !_SCSD_cmd_6byte_response_my (responseBuffer, SET_BUS_WIDTH, 2) || responseBuffer[0] != SET_BUS_WIDTH
+		|| !_SCSD_cmd_6byte_response_my (responseBuffer, SET_BLOCKLEN, BYTES_PER_READ) || responseBuffer[0] != SET_BLOCKLEN) {
+		return false;
+	}
+
+	if (!_SCSD_cmd_6byte_response_my (responseBuffer, SEND_STATUS, rca)
+		|| (responseBuffer[3] & 0x1f) != ((SD_STATE_TRAN << 1) | READY_FOR_DATA)) {
+		return false;
+	}
+
+	_SCSD_probeCmd23();
+	return true;
+}
+
 bool _SCSD_initCard (void) {
 	_SCSD_enable_lite();
 	
@@ -217,10 +357,15 @@ bool _SCSD_initCard (void) {
 	_SCSD_relativeCardAddress = 0;
 
 	// Init the card
-	return _SD_InitCard_SDHC (_SCSD_cmd_6byte_response_my, 
+	if (!_SD_InitCard_SDHC (_SCSD_cmd_6byte_response_my, 
 				_SCSD_cmd_17byte_response_my,
 				true,
-				&_SCSD_relativeCardAddress,&isSDHC);
+				&_SCSD_relativeCardAddress,&isSDHC)) {
+		return false;
+	}
+
+	_SCSD_probeCmd23();
+	return true;
 }
 
 /*
@@ -273,7 +418,10 @@ bool _SCSD_startUp_my (void) {
     _SCSD_unlock();
     //printf("Unlocked in _SCSD_startUp_my.\n");
     
-    bool initResult = _SCSD_initCard();
+    u32 start = STAT_TICKS();
+    _SCSD_warmStarted = _SCSD_warmStart();
+    bool initResult = _SCSD_warmStarted || _SCSD_initCard();
+    STAT_ADD(startupTicks, STAT_TICKS() - start);
     //printf("Init card in _SCSD_startUp_my returned %d.\n", initResult);
     
     return initResult;
@@ -305,44 +453,222 @@ bool _SCSD_isInserted_my (void) {
 }
 
 
-bool _SCSD_readSectors_my (u32 sector, u32 numSectors, void* buffer) {
-    //printf("Starting _SCSD_readSectors_my with sector %u and numSectors %u.\n", sector, numSectors);
-    
-    u32 i;
-	u8* dest = (u8*) buffer;
+// Waits for a data block and reads it. The assembly only polls for a short
+// while each call, the deadline is kept here.
+bool _SCSD_readData (u8* dest, u8* crc) {
+	u32 deadline = systimer_deadline(READ_TIMEOUT);
+
+	while (!_SCSD_readData_s(dest, crc)) {
+		if (systimer_expired(deadline)) {
+			STAT_ADD(timeouts, 1);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Sends a data block and waits for the card to take it
+bool _SCSD_writeData (u8* data, u16* crc) {
+	u32 deadline = systimer_deadline(WRITE_TIMEOUT);
+	u32 polls = 0;
+	int result;
+
+	while ((result = _SCSD_writeData_s(data, crc)) == SCSD_WRITE_NOT_READY) {
+		if (systimer_expired(deadline)) {
+			STAT_ADD(timeouts, 1);
+			return false;
+		}
+	}
+
+	if (result == SCSD_WRITE_BUSY) {
+		while (REG_SCSD_DATAWRITE & SCSD_STS_BUSY) {
+			if ((++polls % POLLS_PER_CHECK) == 0 && systimer_expired(deadline)) {
+				STAT_ADD(busyWaitLoops, polls);
+				STAT_ADD(timeouts, 1);
+				return false;
+			}
+		}
+		STAT_ADD(busyWaitLoops, polls);
+		// Send 8 more clocks, as required by the SD card
+		REG_SCSD_DATAWRITE_32;
+		REG_SCSD_DATAWRITE_32;
+	}
+	return true;
+}
+
+// Compares the CRC sent by the card with one calculated over the received sector
+bool _SCSD_crcMatches (u8* data, u8* crc) {
+	u8 calculated[8];
+	int i;
+
+	if ((u32)data & 0x03) {
+		_SD_CRC16 (data, BYTES_PER_READ, calculated);
+	} else {
+		_SCSD_crc16_s ((u32*)data, calculated);
+	}
+
+	for (i = 0; i < 8; i++) {
+		if (calculated[i] != crc[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Waits for the card to get back to the transfer state
+bool _SCSD_waitTransfer (void) {
+	u8 responseBuffer[6];
+	u32 deadline = systimer_deadline(WRITE_TIMEOUT);
+
+	do {
+		if (!_SCSD_sendCommand(SEND_STATUS, _SCSD_relativeCardAddress)
+			|| !_SCSD_getResponse_R1(responseBuffer)
+			|| systimer_expired(deadline)) {
+			return false;
+		}
+	} while (((responseBuffer[3] & 0x1f) != ((SD_STATE_TRAN << 1) | READY_FOR_DATA)));
+	return true;
+}
+
+// Gets the card out of whatever state an error left it in, by ending any
+// transfer and selecting it again
+bool _SCSD_reselect (void) {
 	u8 responseBuffer[6];
+
+	_SCSD_sendCommand(STOP_TRANSMISSION, 0);
+	_SCSD_getResponse_R1b(responseBuffer);
+	_SCSD_sendClocks(64);
+
+	// A deselected card doesn't answer
+	_SCSD_sendCommand(SELECT_CARD, 0);
+	_SCSD_sendClocks(64);
+
+	if (!_SCSD_sendCommand(SELECT_CARD, _SCSD_relativeCardAddress)
+		|| !_SCSD_getResponse_R1b(responseBuffer)
+		|| responseBuffer[0] != SELECT_CARD) {
+		return false;
+	}
+	return _SCSD_waitTransfer();
+}
+
+// Reads a run of sectors, stopping early at the first one that fails.
+// Returns how many sectors were read intact.
+u32 _SCSD_readRun (u32 sector, u32 numSectors, u8* dest) {
+    u32 i = 0;
+	u8 responseBuffer[6];
+	u8 crc[8];
+	u8* crcBuffer = _SCSD_verifyReads ? crc : NULL;
 	u32 argument = isSDHC ? sector : sector * BYTES_PER_READ;
     if (numSectors == 1) {
         //printf("Reading single sector.\n");
         if (!_SCSD_sendCommand(READ_SINGLE_BLOCK, argument)) {
             //printf("Failed to send READ_SINGLE_BLOCK command.\n");
-            return false;
+            return 0;
         }
 
-        if (!_SCSD_readData_s(buffer)) {
+        if (!_SCSD_readData(dest, crcBuffer)) {
             //printf("Failed to read data for single sector.\n");
-            return false;
+            return 0;
         }
+        if (crcBuffer && !_SCSD_crcMatches(dest, crc)) {
+            STAT_ADD(crcErrors, 1);
+        } else {
+            i = 1;
+        }
+        STAT_ADD(singleReads, 1);
     } else {
+        // Pre-declare the transfer length so the card ends it by itself
+        bool blockCountSet = false;
+        if (_SCSD_cmd23Supported) {
+            if (_SCSD_sendCommand(SET_BLOCK_COUNT, numSectors)
+                && _SCSD_getResponse_R1(responseBuffer)
+                && responseBuffer[0] == SET_BLOCK_COUNT) {
+                blockCountSet = true;
+                cmd23RejectsInARow = 0;
+            } else {
+                // A glitch is retried on the next read, a card that keeps refusing isn't
+                STAT_ADD(cmd23Rejects, 1);
+                if (++cmd23RejectsInARow >= CMD23_MAX_REJECTS)
+                    _SCSD_cmd23Supported = false;
+            }
+        }
+
         //printf("Reading multiple sectors.\n");
         if (!_SCSD_sendCommand(READ_MULTIPLE_BLOCK, argument)) {
             //printf("Failed to send READ_MULTIPLE_BLOCK command.\n");
-            return false;
+            return 0;
         }
 
         for (i = 0; i < numSectors; i++, dest += BYTES_PER_READ) {
-            if (!_SCSD_readData_s(dest)) {
+            if (!_SCSD_readData(dest, crcBuffer)) {
                 //printf("Failed to read data at sector %u.\n", i + sector);
-                return false;
+                break;
+            }
+            if (crcBuffer && !_SCSD_crcMatches(dest, crc)) {
+                STAT_ADD(crcErrors, 1);
+                break;
             }
         }
 
-        //printf("Stopping transmission after multiple sectors.\n");
-        _SCSD_sendCommand(STOP_TRANSMISSION, 0);
-        _SCSD_getResponse_R1b(responseBuffer);
+        if (blockCountSet) {
+            STAT_ADD(multiReadsCmd23, 1);
+        } else {
+            STAT_ADD(multiReadsStop, 1);
+        }
+        if (!blockCountSet || i < numSectors) {
+            //printf("Stopping transmission after multiple sectors.\n");
+            _SCSD_sendCommand(STOP_TRANSMISSION, 0);
+            _SCSD_getResponse_R1b(responseBuffer);
+        }
     }
 
     _SCSD_sendClocks(64);
+    STAT_ADD(sectorsRead, i);
+    return i;
+}
+
+
+bool _SCSD_readSectors_my (u32 sector, u32 numSectors, void* buffer) {
+    //printf("Starting _SCSD_readSectors_my with sector %u and numSectors %u.\n", sector, numSectors);
+
+	u8* dest = (u8*) buffer;
+	u32 numRead;
+	u32 numWanted;
+	u32 failures = 0;
+	u32 start = STAT_TICKS();
+	u32 retryStart = 0;
+
+	while (numSectors) {
+		// After a failure only the sector that failed is asked for again
+		numWanted = failures ? 1 : numSectors;
+		numRead = _SCSD_readRun(sector, numWanted, dest);
+		sector += numRead;
+		numSectors -= numRead;
+		dest += numRead * BYTES_PER_READ;
+
+		if (numRead == numWanted) {
+			if (failures) {
+				STAT_ADD(retryTicks, STAT_TICKS() - retryStart);
+				failures = 0;
+			}
+			continue;
+		}
+
+		if (failures == 0) {
+			retryStart = STAT_TICKS();
+		}
+		if (++failures > READ_RETRIES) {
+			STAT_ADD(retryTicks, STAT_TICKS() - retryStart);
+			STAT_ADD(readTicks, STAT_TICKS() - start);
+			return false;
+		}
+		STAT_ADD(retries, 1);
+		if (failures >= RESELECT_AFTER) {
+			_SCSD_reselect();
+		}
+	}
+
+	STAT_ADD(readTicks, STAT_TICKS() - start);
     //printf("Completed _SCSD_readSectors_my.\n");
     return true;
 }
@@ -355,7 +681,8 @@ bool _SCSD_writeSectors_my (u32 sector, u32 numSectors, const void* buffer) {
 	u8 responseBuffer[6];
     u32 offset = isSDHC ? sector : sector * BYTES_PER_READ;
     u8* data = (u8*) buffer;
-    int i;
+    u32 start = STAT_TICKS();
+    bool success = false;
 
     while (numSectors--) {
         //printf("Writing sector at offset %u.\n", offset);
@@ -365,12 +692,12 @@ bool _SCSD_writeSectors_my (u32 sector, u32 numSectors, const void* buffer) {
         _SCSD_sendCommand(WRITE_BLOCK, offset);
         if (!_SCSD_getResponse_R1(responseBuffer)) {
             //printf("Failed to get response after WRITE_BLOCK command.\n");
-            return false;
+            goto write_end;
         }
 
-        if (!_SCSD_writeData_s(data, crc)) {
+        if (!_SCSD_writeData(data, crc)) {
             //printf("Failed to write data and CRC.\n");
-            return false;
+            goto write_end;
         }
 
         _SCSD_sendClocks(64);
@@ -378,20 +705,21 @@ bool _SCSD_writeSectors_my (u32 sector, u32 numSectors, const void* buffer) {
         offset += isSDHC ? 1 : BYTES_PER_READ;
         data += BYTES_PER_READ;
 
-        i = WRITE_TIMEOUT;
-        do {
-            _SCSD_sendCommand(SEND_STATUS, _SCSD_relativeCardAddress);
-            if (!_SCSD_getResponse_R1(responseBuffer) || i-- <= 0) {
-                //printf("Timeout or error during write confirmation.\n");
-                return false;
-            }
-        } while (((responseBuffer[3] & 0x1f) != ((SD_STATE_TRAN << 1) | READY_FOR_DATA)));
+        if (!_SCSD_waitTransfer()) {
+            //printf("Timeout or error during write confirmation.\n");
+            STAT_ADD(timeouts, 1);
+            goto write_end;
+        }
+        STAT_ADD(sectorsWritten, 1);
 
         //printf("Sector at offset %u written successfully.\n", offset - BYTES_PER_READ);
     }
 
     //printf("Completed _SCSD_writeSectors_my.\n");
-    return true;
+    success = true;
+write_end:
+    STAT_ADD(writeTicks, STAT_TICKS() - start);
+    return success;
 }
 
 
@@ -48,6 +48,7 @@
 #define SET_BLOCKLEN 16
 #define READ_SINGLE_BLOCK 17
 #define READ_MULTIPLE_BLOCK 18
+#define SET_BLOCK_COUNT 23
 #define WRITE_BLOCK 24
 #define WRITE_MULTIPLE_BLOCK 25
 #define APP_CMD 55
@@ -57,6 +58,7 @@
 /* SD App commands */
 #define SET_BUS_WIDTH 6
 #define SD_APP_OP_COND 41
+#define SEND_SCR 51
 
 /* OCR (Operating Conditions Register) send value */
 #define SD_OCR_VALUE 0x00030000 /* 2.8V to 3.0V */
@@ -80,6 +82,10 @@
 
 #define READY_FOR_DATA 1	// bit 8 in card status
 
+/* SCR (SD Configuration Register) */
+#define SCR_LENGTH 8
+#define SCR_CMD23_SUPPORT 0x02	// bit 33 of the SCR, in byte 3
+
 
 
 ///Mod:
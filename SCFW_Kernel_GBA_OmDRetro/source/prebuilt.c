@@ -0,0 +1,59 @@
+#include <gba.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include "prebuilt.h"
+
+bool prebuilt_identify(const char *path, struct prebuilt_source *source) {
+	u8 head[PREBUILT_HASHED];
+	struct stat st;
+
+	if (stat(path, &st))
+		return false;
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		return false;
+	u32 len = fread(head, 1, sizeof head, file);
+	fclose(file);
+	source->size = st.st_size;
+	// A PC may still show the odd second of a file it just wrote
+	source->mtime = (u32) st.st_mtime & ~1;
+
+	u32 hash = 0x811C9DC5;
+	for (u32 i = 0; i < len; ++i) {
+		hash ^= head[i];
+		hash *= 0x01000193;
+	}
+	source->hash = hash;
+	return true;
+}
+
+static bool same(const struct prebuilt_source *l, const struct prebuilt_source *r) {
+	return l->size == r->size && l->mtime == r->mtime && l->hash == r->hash;
+}
+
+FILE *prebuilt_open(const char *path, u32 patches, struct prebuilt_header *header) {
+	char image_path[PATH_MAX];
+	struct prebuilt_source source;
+
+	if (strlen(path) + sizeof PREBUILT_EXT > sizeof image_path)
+		return NULL;
+	strcpy(image_path, path);
+	strcat(image_path, PREBUILT_EXT);
+	FILE *image = fopen(image_path, "rb");
+	if (!image)
+		return NULL;
+
+	bool ok = fread(header, sizeof *header, 1, image) == 1 && header->magic == PREBUILT_MAGIC && header->patches == patches
+		&& prebuilt_identify(path, &source) && same(&source, &header->game);
+	if (ok && header->core_path[0]) {
+		header->core_path[sizeof header->core_path - 1] = '\0';
+		ok = prebuilt_identify(header->core_path, &source) && same(&source, &header->core);
+	}
+	if (!ok) {
+		fclose(image);
+		return NULL;
+	}
+	return image;
+}
@@ -0,0 +1,45 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <gba.h>
+
+// Boot and launch phases timed by the profiler, in the order they run
+enum profile_phase {
+	PROFILE_OVERCLOCK,
+	PROFILE_SD_STARTUP,
+	PROFILE_FAT_MOUNT,
+	PROFILE_SETTINGS,
+	PROFILE_AUTOSAVE,
+	PROFILE_FIRST_LISTING,
+	PROFILE_FLASHROM,
+	PROFILE_WHITESCREEN_PATCH,
+	PROFILE_SPECIFIC_GAME_PATCH,
+	PROFILE_SAVE_FIND_TAG,
+	PROFILE_SAVE_PATCH,
+	PROFILE_RESET_PATCH,
+	PROFILE_L_SEQ,
+	PROFILE_PHASES
+};
+
+#define PROFILE_BOOT	PROFILE_OVERCLOCK, PROFILE_FIRST_LISTING
+#define PROFILE_LAUNCH	PROFILE_FLASHROM, PROFILE_L_SEQ
+// Power-on to game, when the menu was skipped
+#define PROFILE_AUTOBOOT	PROFILE_OVERCLOCK, PROFILE_L_SEQ
+
+// Only built with SCFW_PROFILE, otherwise the markers compile to nothing
+#ifdef SCFW_PROFILE
+void profile_begin(enum profile_phase phase);
+void profile_end(enum profile_phase phase);
+// Shows the phases from first to last, appends them to /scfw/profile.csv and clears them
+void profile_report(const char *event, enum profile_phase first, enum profile_phase last);
+
+#define PROFILE_BEGIN(phase) profile_begin(phase)
+#define PROFILE_END(phase) profile_end(phase)
+#define PROFILE_REPORT(event, phases) profile_report(event, phases)
+#else
+#define PROFILE_BEGIN(phase) ((void)0)
+#define PROFILE_END(phase) ((void)0)
+#define PROFILE_REPORT(event, phases) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <gba.h>
+
+// Progress bar for long transfers, with speed and time left, drawn over the
+// bottom two rows of the console from the VBlank interrupt. Transfer loops only
+// store how far they got, keeping console formatting out of them.
+
+// Call once, after textmap_init
+void progress_init();
+
+void progress_begin(u32 total);
+void progress_end();
+
+extern volatile u32 progress_done;
+
+static inline void progress_set(u32 done) {
+	progress_done = done;
+}
+
+// Redraws straight away, for loops that run with interrupts off
+void progress_draw();
+
+#endif
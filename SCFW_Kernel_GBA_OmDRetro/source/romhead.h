@@ -0,0 +1,100 @@
+#ifndef ROMHEAD_H
+#define ROMHEAD_H
+
+#include <gba.h>
+
+// The headers the emulator cores look for in front of each game or support
+// file. tools/scpack builds images on a PC with the same builders, so they
+// must stay free of anything only the kernel has.
+
+struct bwsc_h{
+	u32 id; //BWS",0x1A
+	u32 filesize;
+	u32 flags;			// Bit 1 = PCV2, Bit 2 = WSC, Bit 3 = SwanCrystal.
+	u32 undef;
+	u32 bios;				// Bit 0 = Bios,
+	u32 res0, res1, res2;
+	char name[32];
+};
+
+struct CoG_h {
+	u16 r_size;
+	char pad[9];
+}; //total of 11 bytes
+
+struct hvca_h{
+	long id; //long magic equivalent to HEX 70 41 17 04
+	char filename[32]; 
+	char ext[4];
+	long filesize;
+};
+
+struct mpa2_h{
+    u32 TotalH_size;
+    u32 h_size;
+    char songtitle[40];
+    u32 term0,term1;
+};
+
+struct ngp_h{
+	u32 id; //NGP,0x1A
+	u32 filesize;
+	u32 flags; // flags + branch hacks + reserved
+	u32 follow;
+	u32 bios, res0, res1, res2;	// bit 0 = bios file.
+	char name[32];
+};
+
+struct pcea_h {
+	char name[32];
+	u32 filesize;
+	u32 flags;
+	u32 follow;
+	u32 f_address;
+	u32 id;
+	char unk[12];
+};
+
+struct pnes_h {
+	char name[32];
+	u32 filesize;
+	u32 flags;
+	u32 follow;
+	u32 reserved;
+};
+
+struct drsms_h {
+	u8 id; //ROM #. ROM 0 is the emulator itself so ROMs actually start at 1
+	char pad0[5]; //pad 5 bytes of data
+	u8 flags; //Indicate if USA/JAP ROM(bit 2) or EUR ROM(bit 3) or Game Gear Japan ROM (bit 1)
+	char pad1[5]; //pad 5 bytes for SMS. If Game Gear ROM, assign pad1[1]= 0x01 ~ means game gear mode
+	char name[28];
+};
+
+struct smsa_h {
+	u32 id;
+	u32 filesize;
+	u16 flags;
+	u16 hacks;
+	u32 follow;
+	u32 B_flag, res0, res1, res2; //BIOS flags + 15 bytes of reserved data
+	char name[32];
+};
+
+struct wsv_h{
+	u32 id; //WSV,0x1A
+	u32 filesize;
+	u32 flags;
+	u32 follow;
+	u32 bios; // bit 0 = bios file.
+	u32 res[3];
+	char name[32];
+};
+
+// The first three characters of an emulator's id, as it reads them
+u32 u32conv(const char* text);
+// A game's header as its launch writes it, size is the game's
+void romhead_pnes(struct pnes_h *head, const char *path, u32 size);
+void romhead_smsa(struct smsa_h *head, const char *path, u32 size);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include <gba.h>
+
+// The kernel's settings and the last played and last saved paths, kept in
+// /scfw/state.bin. The file is made once and never changes size. It holds
+// two copies of the record, and every update overwrites the older one
+// with a raw write, so losing power mid-write still leaves the other.
+#define STATE_PATH "/scfw/state.bin"
+#define STATE_MAGIC 0x54534353	// "SCST"
+#define STATE_SLOTS 2
+#define STATE_SETTINGS_MAX 96
+#define STATE_PATH_MAX 456
+
+struct kernel_state {
+	u32 magic;
+	u32 seq;			// the copy with the higher one is current
+	u32 checksum;
+	u32 settings_size;	// a newer kernel with more settings keeps its defaults for the rest
+	u8 settings[STATE_SETTINGS_MAX];
+	char last_played[STATE_PATH_MAX];
+	char last_saved[STATE_PATH_MAX];	// empty unless a game was started with autosave
+};
+
+extern struct kernel_state kernel_state;
+
+// Reads the current record into kernel_state, false if there is none yet
+bool state_load();
+// Writes kernel_state over the older copy, creating the file if needed
+bool state_commit();
+
+#endif
@@ -0,0 +1,29 @@
+#include <gba.h>
+#include "systimer.h"
+
+#define TIMER_PRESCALER_64 1
+
+void systimer_init() {
+	REG_TM2CNT_H = 0;
+	REG_TM3CNT_H = 0;
+	REG_TM2CNT_L = 0;
+	REG_TM3CNT_L = 0;
+	REG_TM3CNT_H = TIMER_START | TIMER_COUNT;
+	REG_TM2CNT_H = TIMER_START | TIMER_PRESCALER_64;
+}
+
+// Leave the timers the way a game expects to find them
+void systimer_stop() {
+	REG_TM2CNT_H = 0;
+	REG_TM3CNT_H = 0;
+}
+
+u32 systimer_ticks() {
+	u16 hi, lo;
+	// Read again if TM2 overflowed between the two halves
+	do {
+		hi = REG_TM3CNT_L;
+		lo = REG_TM2CNT_L;
+	} while (hi != REG_TM3CNT_L);
+	return ((u32)hi << 16) | lo;
+}
@@ -0,0 +1,35 @@
+#ifndef SYSTIMER_H
+#define SYSTIMER_H
+
+#include <gba.h>
+
+// Free running tick counter made of TM2 (prescaled to F/64) cascaded into TM3.
+// It wraps after about 4.5 hours, so differences of two readings are always valid.
+#define SYSTIMER_HZ 262144
+
+// Converts a constant time to ticks, rounding up so a deadline is never short
+#define SYSTIMER_US(us) ((u32)(((u64)(us) * SYSTIMER_HZ + 999999) / 1000000))
+#define SYSTIMER_MS(ms) SYSTIMER_US((u64)(ms) * 1000)
+
+void systimer_init();
+void systimer_stop();
+u32 systimer_ticks();
+
+// Deadlines are plain tick values, compared so they keep working across a wrap
+static inline u32 systimer_deadline(u32 ticks) {
+	return systimer_ticks() + ticks;
+}
+
+static inline bool systimer_expired(u32 deadline) {
+	return (s32)(systimer_ticks() - deadline) >= 0;
+}
+
+static inline u32 systimer_to_us(u32 ticks) {
+	return ((u64)ticks * 15625) >> 12;
+}
+
+static inline u32 systimer_to_ms(u32 ticks) {
+	return ((u64)ticks * 125) >> 15;
+}
+
+#endif
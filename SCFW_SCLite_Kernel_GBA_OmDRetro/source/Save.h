@@ -56,6 +56,8 @@ struct save_type
 
 extern u32 romSize;
 const struct save_type* save_findTag();
+// The entry save_findTag would return for a type it found before, NULL for none
+const struct save_type* save_findType(u16 type);
 
 void twoByteCpy(u16 *dst, const u16 *src, u32 size);
 // #ifdef __cplusplus
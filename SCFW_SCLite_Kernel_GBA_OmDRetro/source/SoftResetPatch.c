@@ -0,0 +1,59 @@
+#include <gba.h>
+#include <stdio.h>
+#include "irq_hook.h"
+#include "SoftResetPatch.h"
+
+#define GBA_ROM ((vu32*) 0x08000000)
+
+static bool is_empty(s32 *buf, int size) {
+	bool ones = false;
+	bool zeroes = false;
+	for (int i = 0; i < size; ++i) {
+		if (buf[i] == 0 && !ones) {
+			zeroes = true;
+		}
+		else if (buf[i] == -1 && !zeroes) {
+			ones = true;
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+void resetPatch(u32 romsize) {
+	iprintf("Soft reset patching...\n");
+	
+	u32 original_branch = *GBA_ROM;
+	u32 original_entrypoint = ((original_branch & 0x00ffffff) << 2) + 0x08000008;
+	u32 patched_entrypoint = 0x09ffff00 - irq_hook_bin_len - 4;
+	if (patched_entrypoint < 0x08000000 + romsize)
+		while (patched_entrypoint > 0x080000c0) {
+			if (is_empty((s32*)(uintptr_t) patched_entrypoint, irq_hook_bin_len + 4))
+				break;
+			patched_entrypoint -= 4;
+		}
+	if (patched_entrypoint <= 0x080000c0) {
+		iprintf("Could not soft reset patch\n");
+		return;
+	}
+	u32 patched_branch = 0xea000000 | ((patched_entrypoint - 0x08000008) >> 2);
+	
+	int ctr = 0;
+	for (int i = 0; i < romsize >> 2; ++i)
+		if (GBA_ROM[i] == 0x03007ffc) {
+			GBA_ROM[i] = 0x03fffff4;
+			++ctr;
+		}
+	if (!ctr) {
+		iprintf("Could not soft reset patch!\n");
+		return;
+	}
+	*GBA_ROM = patched_branch; 
+	int i;
+	for (i = 0; i < irq_hook_bin_len >> 2; ++i)
+		i[(u32*)(uintptr_t) patched_entrypoint] = i[(u32*) irq_hook_bin];
+	i[(u32*)(uintptr_t) patched_entrypoint] = original_entrypoint;
+	iprintf("Patched!\n");
+}
@@ -0,0 +1,92 @@
+#include <gba.h>
+#include <stdio.h>
+#include <string.h>
+#include "asset.h"
+
+struct asset_header {
+	u32 magic;
+	u32 count;
+};
+
+EWRAM_BSS static struct asset assets[ASSETS_MAX];
+static u32 assets_len;
+static u32 next_replaced;
+static bool handed_out[ASSETS_MAX];	// since the last save, not to be replaced
+static bool loaded;
+static bool dirty;
+
+static void load() {
+	struct asset_header header;
+
+	loaded = true;
+	assets_len = 0;
+	FILE *file = fopen(ASSET_PATH, "rb");
+	if (!file)
+		return;
+	if (fread(&header, sizeof header, 1, file) == 1 && header.magic == ASSET_MAGIC && header.count <= ASSETS_MAX
+	    && fread(assets, sizeof *assets, header.count, file) == header.count)
+		assets_len = header.count;
+	fclose(file);
+}
+
+// The next record round the table that no caller may still be holding
+static struct asset *replaceable() {
+	for (u32 i = 0; i < ASSETS_MAX; ++i) {
+		u32 n = next_replaced++ % ASSETS_MAX;
+		if (!handed_out[n])
+			return &assets[n];
+	}
+	return NULL;
+}
+
+const struct asset *asset_get(const char *path) {
+	if (strlen(path) >= sizeof assets->path)
+		return NULL;
+	if (!loaded)
+		load();
+
+	// Records stay where they are, pointers handed out remain valid
+	struct asset *asset = NULL;
+	struct asset *free_slot = NULL;
+	for (u32 i = 0; i < assets_len && !asset; ++i) {
+		if (!strcmp(assets[i].path, path))
+			asset = &assets[i];
+		else if (!assets[i].path[0] && !free_slot)
+			free_slot = &assets[i];
+	}
+	if (asset && fatmap_unchanged(&asset->file)) {
+		handed_out[asset - assets] = true;
+		return asset;
+	}
+
+	if (!asset)
+		asset = free_slot ? free_slot : assets_len < ASSETS_MAX ? &assets[assets_len++] : replaceable();
+	if (!asset)
+		return NULL;
+	dirty = true;
+	strcpy(asset->path, path);
+	if (!fatmap_mapFile(path, &asset->file, asset->extents, ASSET_EXTENTS)) {
+		// Gone, free its record
+		asset->path[0] = '\0';
+		return NULL;
+	}
+	handed_out[asset - assets] = true;
+	return asset;
+}
+
+void asset_release() {
+	memset(handed_out, 0, sizeof handed_out);
+}
+
+void asset_save() {
+	asset_release();
+	if (!dirty)
+		return;
+	FILE *file = fopen(ASSET_PATH, "wb");
+	if (!file)
+		return;
+	struct asset_header header = { ASSET_MAGIC, assets_len };
+	if (fwrite(&header, sizeof header, 1, file) == 1 && fwrite(assets, sizeof *assets, assets_len, file) == assets_len)
+		dirty = false;
+	fclose(file);
+}
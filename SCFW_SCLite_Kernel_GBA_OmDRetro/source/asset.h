@@ -0,0 +1,31 @@
+#ifndef ASSET_H
+#define ASSET_H
+
+#include <gba.h>
+#include "fatmap.h"
+
+// The files under /scfw that launches load every time: emulators and BIOS
+// images. Where each one lies on the card is remembered in /scfw/assets.bin,
+// so a launch can stream it by sector without any lookups. A record is used
+// as long as the file's directory entry, which holds its size, first cluster
+// and write time, reads back the same.
+#define ASSET_PATH "/scfw/assets.bin"
+#define ASSET_MAGIC 0x31545341	// "AST1"
+#define ASSETS_MAX 64		// room for every emulator, BIOS and bundle file
+#define ASSET_EXTENTS 6
+
+struct asset {
+	char path[64];
+	struct fatmap_file file;
+	struct fatmap_extent extents[ASSET_EXTENTS];
+};
+
+// Looks a file up, NULL if it doesn't exist. path must be under 64 characters.
+// The record stays valid until asset_release, none handed out is replaced before.
+const struct asset *asset_get(const char *path);
+// Lets records be replaced again, once no pointer from asset_get is held
+void asset_release();
+// Writes the records back if any changed, call it before leaving the kernel
+void asset_save();
+
+#endif
@@ -0,0 +1,121 @@
+#include <gba.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "bundle.h"
+
+struct bundle_header {
+	u32 magic;
+	u32 count;
+};
+
+EWRAM_BSS static struct bundle bundles[BUNDLES_MAX];
+static u32 bundles_len;
+static bool loaded;
+
+static void load() {
+	struct bundle_header header;
+
+	loaded = true;
+	bundles_len = 0;
+	FILE *file = fopen(BUNDLE_INDEX, "rb");
+	if (!file)
+		return;
+	if (fread(&header, sizeof header, 1, file) == 1 && header.magic == BUNDLE_MAGIC && header.count <= BUNDLES_MAX
+	    && fread(bundles, sizeof *bundles, header.count, file) == header.count)
+		bundles_len = header.count;
+	fclose(file);
+}
+
+static bool save() {
+	FILE *file = fopen(BUNDLE_INDEX, "wb");
+	if (!file)
+		return false;
+	struct bundle_header header = { BUNDLE_MAGIC, bundles_len };
+	bool ok = fwrite(&header, sizeof header, 1, file) == 1 && fwrite(bundles, sizeof *bundles, bundles_len, file) == bundles_len;
+	fclose(file);
+	return ok;
+}
+
+static struct bundle *find(const char *name) {
+	if (!loaded)
+		load();
+	for (u32 i = 0; i < bundles_len; ++i)
+		if (!strcmp(bundles[i].name, name))
+			return &bundles[i];
+	return NULL;
+}
+
+// Names are under BUNDLE_NAME_MAX, so the path fits an asset's
+static void bundle_path(char *path, const char *name) {
+	sprintf(path, BUNDLE_DIR "/%s.bin", name);
+}
+
+const struct asset *bundle_get(const char *name, const char *const inputs[], u32 inputs_len) {
+	char path[64];
+
+	const struct bundle *bundle = name[0] ? find(name) : NULL;
+	if (!bundle || bundle->inputs_len != inputs_len)
+		return NULL;
+	for (u32 i = 0; i < inputs_len; ++i) {
+		// Without a directory entry a stale input couldn't be told apart
+		const struct asset *input = asset_get(inputs[i]);
+		if (!input || !input->file.entry_sector || strcmp(bundle->inputs[i].path, inputs[i]) || memcmp(bundle->inputs[i].entry, input->file.entry, sizeof input->file.entry))
+			return NULL;
+	}
+	bundle_path(path, name);
+	const struct asset *file = asset_get(path);
+	if (!file || !file->file.entry_sector || file->file.size != bundle->size || memcmp(bundle->entry, file->file.entry, sizeof bundle->entry))
+		return NULL;
+	return file;
+}
+
+FILE *bundle_begin(const char *name) {
+	char path[64];
+
+	if (!name[0] || strlen(name) >= BUNDLE_NAME_MAX)
+		return NULL;
+	mkdir(BUNDLE_DIR, 0777);
+	bundle_path(path, name);
+	return fopen(path, "wb");
+}
+
+bool bundle_end(FILE *file, const char *name, const char *const inputs[], u32 inputs_len, bool ok) {
+	char path[64];
+
+	fclose(file);
+	bundle_path(path, name);
+	struct bundle *bundle = find(name);
+	if (!bundle)
+		bundle = find("");
+	if (!bundle && bundles_len < BUNDLES_MAX)
+		bundle = &bundles[bundles_len++];
+	if (!bundle || inputs_len > BUNDLE_INPUTS)
+		ok = false;
+
+	for (u32 i = 0; ok && i < inputs_len; ++i) {
+		const struct asset *input = asset_get(inputs[i]);
+		if (!input || !input->file.entry_sector) {
+			ok = false;
+		} else {
+			strcpy(bundle->inputs[i].path, inputs[i]);
+			memcpy(bundle->inputs[i].entry, input->file.entry, sizeof input->file.entry);
+		}
+	}
+	const struct asset *written = ok ? asset_get(path) : NULL;
+	if (!written || !written->file.entry_sector) {
+		remove(path);
+		if (bundle) {
+			// Frees the slot, its file is gone
+			bundle->name[0] = '\0';
+			save();
+		}
+		return false;
+	}
+
+	strcpy(bundle->name, name);
+	bundle->size = written->file.size;
+	bundle->inputs_len = inputs_len;
+	memcpy(bundle->entry, written->file.entry, sizeof bundle->entry);
+	return save();
+}
@@ -0,0 +1,43 @@
+#ifndef BUNDLE_H
+#define BUNDLE_H
+
+#include <gba.h>
+#include <stdio.h>
+#include "asset.h"
+
+// Everything an emulator launch streams ahead of the game, the core, the
+// generated headers and the BIOS or support files, written out whole to
+// /scfw/cache the first time so later launches read one file. Each
+// configuration gets its own bundle. /scfw/cache/bundles.bin records the
+// directory entries of the files a bundle was built from, and it is built
+// again as soon as one of them reads back different.
+#define BUNDLE_DIR "/scfw/cache"
+#define BUNDLE_INDEX "/scfw/cache/bundles.bin"
+#define BUNDLE_MAGIC 0x31444E42	// "BND1"
+#define BUNDLES_MAX 16
+#define BUNDLE_INPUTS 6
+#define BUNDLE_NAME_MAX 16
+
+struct bundle_input {
+	char path[64];
+	u8 entry[32];
+};
+
+struct bundle {
+	char name[BUNDLE_NAME_MAX];
+	u32 size;
+	u32 inputs_len;
+	u8 entry[32];		// the bundle's own, so one written over or cut short isn't used
+	struct bundle_input inputs[BUNDLE_INPUTS];
+};
+
+// The bundle's file, mapped for streaming, if it was built from these inputs
+// as they are now. NULL if it has to be built.
+const struct asset *bundle_get(const char *name, const char *const inputs[], u32 inputs_len);
+// Opens the bundle's file for writing
+FILE *bundle_begin(const char *name);
+// Closes it and records what it was built from, or deletes it unless ok.
+// False if it can't be used, also when an input doesn't exist.
+bool bundle_end(FILE *file, const char *name, const char *const inputs[], u32 inputs_len, bool ok);
+
+#endif
@@ -0,0 +1,172 @@
+#include <string.h>
+#include <strings.h>
+#include "dirsort.h"
+
+static void copy(char **out, const char *in, u32 len) {
+	memcpy(*out, in, len);
+	*out += len;
+}
+
+void dirsort_nickname(char *nickname, const char *name, bool isdir) {
+	u32 namelen = strlen(name);
+	// Long names keep their first 20 characters, a '*' and their last few
+	u32 tail = isdir ? 6 : 7;
+	char *out = nickname;
+
+	if (namelen > 28 - isdir) {
+		copy(&out, name, 20);
+		*out++ = '*';
+		copy(&out, name + namelen - tail, tail);
+	} else {
+		copy(&out, name, namelen);
+	}
+	if (isdir)
+		*out++ = '/';
+	*out = '\0';
+}
+
+static u32 fold(char c) {
+	return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : (u8)c;
+}
+
+u32 dirsort_key(const char *nickname) {
+	u32 key = 0;
+	for (int i = 0; i < 4; ++i) {
+		key <<= 8;
+		if (*nickname)
+			key |= fold(*nickname++);
+	}
+	return key;
+}
+
+int dirsort_compare(const struct dirent_brief *entries, const u32 *keys, u16 l, u16 r, bool folders_first) {
+	if (folders_first && entries[l].isdir != entries[r].isdir)
+		return entries[l].isdir ? -1 : 1;
+	if (keys[l] != keys[r])
+		return keys[l] < keys[r] ? -1 : 1;
+	// Equal keys with a NUL in them mean both names already ended
+	if (!(keys[l] & 0xFF))
+		return 0;
+	return strcasecmp(entries[l].nickname + 4, entries[r].nickname + 4);
+}
+
+// Bottom-up merge sort, which keeps the comparisons close to the n log n minimum
+void dirsort_sort(u16 *order, u16 *scratch, u32 count, const struct dirent_brief *entries, const u32 *keys, bool folders_first) {
+	u16 *from = order, *to = scratch;
+
+	for (u32 width = 1; width < count; width *= 2) {
+		for (u32 start = 0; start < count; start += 2 * width) {
+			u32 mid = start + width < count ? start + width : count;
+			u32 end = start + 2 * width < count ? start + 2 * width : count;
+			u32 l = start, r = mid, out = start;
+			while (l < mid && r < end)
+				to[out++] = dirsort_compare(entries, keys, from[r], from[l], folders_first) < 0 ? from[r++] : from[l++];
+			while (l < mid)
+				to[out++] = from[l++];
+			while (r < end)
+				to[out++] = from[r++];
+		}
+		u16 *swap = from;
+		from = to;
+		to = swap;
+	}
+	if (from != order)
+		memcpy(order, from, count * sizeof *order);
+}
+
+static u32 bucket(u32 key) {
+	u32 c = key >> 24;
+	if (c < 'a')
+		return 0;
+	return (c > 'z' ? 'z' : c) - 'a' + 1;
+}
+
+void dirsort_index_build(struct dirsort_index *index, const u16 *order, u32 count, const struct dirent_brief *entries, const u32 *keys, bool folders_first) {
+	u32 folders = 0;
+	if (folders_first)
+		while (folders < count && entries[order[folders]].isdir)
+			++folders;
+
+	index->runs = folders && folders < count ? 2 : 1;
+	for (u32 run = 0, pos = 0; run < index->runs; ++run) {
+		u32 end = run + 1 < index->runs ? folders : count;
+		for (u32 b = 0; b < DIRSORT_BUCKETS; ++b) {
+			while (pos < end && bucket(keys[order[pos]]) < b)
+				++pos;
+			index->start[run][b] = pos;
+		}
+		index->start[run][DIRSORT_BUCKETS] = end;
+		pos = end;
+	}
+}
+
+s32 dirsort_next_letter(const struct dirsort_index *index, const u16 *order, u32 count, const u32 *keys, s32 pos) {
+	if (index->runs) {
+		// Bucket starts only grow, the first one past pos is the next letter
+		for (u32 run = 0; run < index->runs; ++run)
+			for (u32 b = 0; b < DIRSORT_BUCKETS; ++b)
+				if (index->start[run][b] > pos && index->start[run][b] < count)
+					return index->start[run][b];
+		return 0;
+	}
+	u32 here = bucket(keys[order[pos]]);
+	while (++pos < count)
+		if (bucket(keys[order[pos]]) != here)
+			return pos;
+	return 0;
+}
+
+s32 dirsort_prev_letter(const struct dirsort_index *index, const u16 *order, u32 count, const u32 *keys, s32 pos) {
+	if (!pos)
+		pos = count;
+	if (index->runs) {
+		for (s32 run = index->runs - 1; run >= 0; --run)
+			for (s32 b = DIRSORT_BUCKETS - 1; b >= 0; --b)
+				if (index->start[run][b] < pos)
+					return index->start[run][b];
+		return 0;
+	}
+	// Back to the start of this letter, or of the one before if already there
+	u32 here = bucket(keys[order[--pos]]);
+	while (pos && bucket(keys[order[pos - 1]]) == here)
+		--pos;
+	return pos;
+}
+
+// Compares an entry's nickname with the same number of characters from a prefix
+static int compare_prefix(const struct dirent_brief *entry, u32 key, u32 prefix_key, u32 mask, const char *prefix, u32 len) {
+	if ((key & mask) != prefix_key)
+		return (key & mask) < prefix_key ? -1 : 1;
+	return len > 4 ? strncasecmp(entry->nickname + 4, prefix + 4, len - 4) : 0;
+}
+
+s32 dirsort_find(const struct dirsort_index *index, const u16 *order, u32 count, const struct dirent_brief *entries, const u32 *keys, const char *prefix) {
+	u32 len = strlen(prefix);
+	u32 prefix_key = dirsort_key(prefix);
+	u32 mask = len >= 4 ? ~0 : ~(~0u >> 8 * len);
+
+	if (!len)
+		return count ? 0 : -1;
+	if (!index->runs) {
+		for (u32 pos = 0; pos < count; ++pos)
+			if (!compare_prefix(&entries[order[pos]], keys[order[pos]], prefix_key, mask, prefix, len))
+				return pos;
+		return -1;
+	}
+
+	u32 b = bucket(prefix_key);
+	for (u32 run = 0; run < index->runs; ++run) {
+		// Only the prefix's own bucket can hold a match, search it for the first one
+		u32 lo = index->start[run][b], hi = index->start[run][b + 1];
+		while (lo < hi) {
+			u32 mid = (lo + hi) / 2;
+			if (compare_prefix(&entries[order[mid]], keys[order[mid]], prefix_key, mask, prefix, len) < 0)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo < index->start[run][b + 1] && !compare_prefix(&entries[order[lo]], keys[order[lo]], prefix_key, mask, prefix, len))
+			return lo;
+	}
+	return -1;
+}
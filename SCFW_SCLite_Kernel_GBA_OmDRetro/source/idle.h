@@ -0,0 +1,41 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <gba.h>
+#include <stdio.h>
+#include "systimer.h"
+
+// Background jobs run by the menus in the part of each frame they spend
+// waiting for keys. Each job is split into steps a caller-given deadline
+// long, so a key pressed while they run is seen within the frame.
+#define IDLE_TASKS 8
+// What the tasks get of each idle frame, the rest is left for drawing
+#define IDLE_FRAME_TICKS SYSTIMER_MS(8)
+
+// Does some of a job, stopping once deadline expires where it can. Returns
+// false when the job is finished. Its slot then only keeps the numbers for
+// idle_print, until a new job needs it.
+typedef bool (*idle_step)(u32 deadline);
+
+struct idle_task {
+	const char *name;
+	idle_step step;
+	u32 budget;			// most ticks per frame, 0 for no limit besides the frame's
+	bool active;
+	u32 steps;
+	u32 ticks;
+	u32 max;			// the longest step, anything over the budget delays input
+};
+
+// Starts a job, or restarts one with the same step. Its accounting carries on.
+// False only while IDLE_TASKS other jobs are still running.
+bool idle_add(const char *name, idle_step step, u32 budget);
+bool idle_busy(idle_step step);
+// Runs a job to the end in the foreground, when something needs its result
+void idle_finish(idle_step step);
+// Gives the tasks up to ticks, in turns, returning early if a key is pressed
+void idle_run(u32 ticks);
+// Shows each task's runtime, to the console (stdout) or a file
+void idle_print(FILE *out);
+
+#endif
@@ -0,0 +1,49 @@
+#include <gba.h>
+#include <stdio.h>
+#include "iostats.h"
+#include "my_io_scsd.h"
+#include "systimer.h"
+
+void iostats_print(FILE *out, bool compact) {
+#ifdef SCFW_IOSTATS
+	const SCSD_STATS *stats = &_SCSD_stats;
+	u32 multiReads = stats->multiReadsCmd23 + stats->multiReadsStop;
+
+	fiprintf(out, "Sectors read: %lu\n", stats->sectorsRead);
+	fiprintf(out, "Sectors written: %lu\n", stats->sectorsWritten);
+	fiprintf(out, "Single/multi reads: %lu/%lu\n", stats->singleReads, multiReads);
+	fiprintf(out, " CMD23/STOP ended: %lu/%lu\n", stats->multiReadsCmd23, stats->multiReadsStop);
+	fiprintf(out, "CMD23 supported: %i (%lu rejected)\n", _SCSD_cmd23Supported, stats->cmd23Rejects);
+	fiprintf(out, "Busy-wait loops: %lu\n", stats->busyWaitLoops);
+	fiprintf(out, "Timeouts/CRC errors/retries:\n %lu/%lu/%lu\n", stats->timeouts, stats->crcErrors, stats->retries);
+	fiprintf(out, "Startup: %lums (%s)\n", systimer_to_ms(stats->startupTicks), _SCSD_warmStarted ? "warm" : "full");
+	fiprintf(out, "Read time: %lums\n", systimer_to_ms(stats->readTicks));
+	fiprintf(out, "Write time: %lums\n", systimer_to_ms(stats->writeTicks));
+	fiprintf(out, "Busy-wait time: %lums\n", systimer_to_ms(stats->busyWaitTicks));
+	fiprintf(out, "Retry time: %lums\n", systimer_to_ms(stats->retryTicks));
+
+	// The console only has room for a few commands per line
+	fiprintf(out, "Commands:");
+	int shown = 0;
+	for (int i = 0; i < 64; ++i) {
+		if (!stats->commands[i])
+			continue;
+		if (compact && !(shown % 3))
+			fiprintf(out, "\n");
+		fiprintf(out, compact ? " %2i:%-6lu" : "\nCMD%i: %lu", i, stats->commands[i]);
+		++shown;
+	}
+	fiprintf(out, "\n");
+#else
+	fiprintf(out, "I/O statistics were compiled out\n(build with SCFW_IOSTATS).\n");
+#endif
+}
+
+bool iostats_dump(const char *path) {
+	FILE *out = fopen(path, "w");
+	if (!out)
+		return false;
+	iostats_print(out, false);
+	fclose(out);
+	return true;
+}
@@ -0,0 +1,11 @@
+#ifndef IOSTATS_H
+#define IOSTATS_H
+
+#include <gba.h>
+#include <stdio.h>
+
+// Prints the SD driver statistics, to the console (stdout) or a file
+void iostats_print(FILE *out, bool compact);
+bool iostats_dump(const char *path);
+
+#endif
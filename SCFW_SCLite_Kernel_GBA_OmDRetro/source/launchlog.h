@@ -0,0 +1,50 @@
+#ifndef LAUNCHLOG_H
+#define LAUNCHLOG_H
+
+#include <gba.h>
+
+// Ring of per-launch records in /scfw/launchlog.bin, decoded on a PC by
+// tools/launchlog.c. The layout is shared with it, so only ever append fields
+// in place of the reserved ones.
+#define LAUNCHLOG_PATH "/scfw/launchlog.bin"
+#define LAUNCHLOG_RECORDS 64
+
+struct launchlog_record {
+	u32 seq;			// increases with every launch, 0 marks an unused slot
+	u32 path_hash;		// FNV-1a of the full path
+	u32 bytes_loaded;
+	u32 load_ms;
+	u32 save_bytes;
+	u16 patch_ms;
+	u16 save_ms;
+	u16 save_type;		// enum SaveType, SAVE_TYPE_NONE if none was found
+	u16 timeouts;		// SD errors during the launch, with SCFW_IOSTATS
+	u16 crc_errors;
+	u8 retries;
+	u8 system;			// index into launchlog_systems
+};
+
+#define LAUNCHLOG_SYSTEMS 20
+
+extern const char *const launchlog_systems[LAUNCHLOG_SYSTEMS + 1];
+
+// The system a file is for, from its extension, 0 if none matches
+u8 launchlog_system(const char *path);
+
+// Collected by the loader while a game is launched
+struct launchlog_totals {
+	u32 bytes_loaded;
+	u32 load_ticks;
+	u32 patch_ticks;
+	u32 save_bytes;
+	u32 save_ticks;
+	u16 save_type;
+};
+
+extern struct launchlog_totals launchlog_totals;
+
+void launchlog_begin(const char *path);
+// Writes the launch's record over the oldest one, a single sector write once the log exists
+bool launchlog_commit();
+
+#endif
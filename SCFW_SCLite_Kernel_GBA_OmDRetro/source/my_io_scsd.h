@@ -45,4 +45,30 @@
 // export interface
 extern const DISC_INTERFACE _my_io_scsd ;
 
+// Driver statistics, only gathered when built with SCFW_IOSTATS
+typedef struct {
+	u32 commands[64];		// commands issued, by opcode (app commands included)
+	u32 sectorsRead;
+	u32 sectorsWritten;
+	u32 singleReads;		// reads of exactly one sector
+	u32 multiReadsCmd23;	// multi-block reads pre-declared with SET_BLOCK_COUNT
+	u32 multiReadsStop;		// multi-block reads ended with STOP_TRANSMISSION
+	u32 cmd23Rejects;		// SET_BLOCK_COUNT commands that failed, the read then used STOP_TRANSMISSION
+	u32 busyWaitLoops;		// iterations spent polling the card
+	u32 timeouts;
+	u32 crcErrors;			// sectors that failed their CRC check
+	u32 retries;			// sectors read again after an error
+	// Time spent, in systimer ticks
+	u32 readTicks;
+	u32 writeTicks;
+	u32 busyWaitTicks;
+	u32 retryTicks;
+	u32 startupTicks;
+} SCSD_STATS;
+
+extern SCSD_STATS _SCSD_stats;
+extern bool _SCSD_cmd23Supported;	// card advertises SET_BLOCK_COUNT in its SCR
+extern bool _SCSD_verifyReads;		// check the CRC16 of every sector read, retrying bad ones
+extern bool _SCSD_warmStarted;		// the last startup reused the card as the firmware left it
+
 #endif	// define IO_SCSD_H
@@ -46,11 +46,16 @@
 	.equ	REG_SCSD_DATAREAD,	0x09100000
 	.equ	BYTES_PER_READ,	0x200
 	.equ	SCSD_STS_BUSY,	0x100
-	.equ	BUSY_WAIT_TIMEOUT, 0x10000
+	@ Polls before giving control back to C, which keeps the real deadline
+	.equ	BUSY_WAIT_TIMEOUT, 0x1000
 	.equ	FALSE,	0
 	.equ	TRUE,	1
+	.equ	BUSY,	2
 
-@ bool _SCSD_writeData_s (u8 *data, u16* crc)
+@ int _SCSD_writeData_s (u8 *data, u16* crc)
+@ Returns FALSE if the card had no free buffer yet (nothing was sent, so it can
+@ be called again), BUSY if the block went out but the card is still receiving
+@ it, and TRUE once the card has taken the block.
 
     .global _SCSD_writeData_s
 	
@@ -123,7 +128,7 @@ _SCSD_writeData_crc:
 _SCSD_writeData_finished_wait:
 	@ Test for timeout
 	subs	r4, r4, #1
-	moveq	r0, #FALSE			@ return false on failure
+	moveq	r0, #BUSY			@ the caller finishes waiting
 	beq		_SCSD_writeData_return
 	@ Check the busy bit of the status register
 	ldrh	r3, [r2]   
@@ -140,12 +145,15 @@ _SCSD_writeData_return:
 	ldmfd	r13!,{r4-r5}
 	bx      r14
 
-@ bool _SCSD_readData_s (u8 *data)
+@ bool _SCSD_readData_s (u8 *data, u8 *crc)
+@ crc may be NULL, otherwise the 8 CRC bytes sent by the card are stored there
+@ Returns false without reading anything if no start bit came, so it can be called again
 
     .global _SCSD_readData_s
 	
 _SCSD_readData_s:
 	push	{r4, lr}
+	mov	r12, r1
 	mov	r2, #145 << 20
 	mov	r1, #128 << 1
 	ldr	r3, .L101
@@ -213,6 +221,8 @@ _SCSD_readData_s:
 	cmp	r0, r3
 	bne	.L90
 .L92:
+	cmp	r12, #0
+	bne	.L93
 	mov	r3, #145 << 20
 	ldr	r2, [r3]
 	mov	r0, #1
@@ -225,6 +235,21 @@ _SCSD_readData_s:
 	ldr	r2, [r3]
 	ldrh	r3, [r3]
 	b	.L97
+.L93:
+	ldr	r2, .L101+4
+	mov	r3, #4
+.L94:
+	ldr	r1, [r2]
+	ldr	r1, [r2]
+	strb	r1, [r12], # 1
+	lsr	r1, r1, #8
+	strb	r1, [r12], # 1
+	subs	r3, r3, #1
+	bne	.L94
+	mov	r3, #145 << 20
+	mov	r0, #1
+	ldrh	r3, [r3]
+	b	.L97
 .L100:
 	ldr	r2, .L101+4
 	b .L99
@@ -277,6 +302,88 @@ _SCSD_readData_s:
 .L102:
 	.align	2
 .L101:
-	.word	0x7A120
+	.word	BUSY_WAIT_TIMEOUT
 	.word	0x09100002
 
+@ void _SCSD_crc16_s (const u32 *data, u8 *crc)
+@ Calculates the CRC16 of a word aligned sector for 4 data lines at once.
+@ The four interleaved CRC16s (x^16 + x^12 + x^5 + 1) work out the same as
+@ one CRC with the polynomial x^64 + x^48 + x^20 + 1 over the whole stream,
+@ whose feedback is sparse enough to fold in a word at a time without tables.
+@ r2:r3 hold the high and low halves of that 64 bit CRC.
+
+    .global _SCSD_crc16_s
+
+_SCSD_crc16_s:
+	stmfd	r13!, {r4-r9}
+	mov	r2, #0
+	mov	r3, #0
+	mov	r9, #BYTES_PER_READ / 16
+
+_SCSD_crc16_loop:
+	ldmia	r0!, {r4-r7}
+
+	@ Byte swap, since the first byte on the bus is the most significant
+	eor	r8, r4, r4, ror #16
+	bic	r8, r8, #0x00ff0000
+	mov	r4, r4, ror #8
+	eor	r4, r4, r8, lsr #8
+	@ f = hi ^ data, h = f ^ (f >> 16)
+	eor	r4, r4, r2
+	eor	r4, r4, r4, lsr #16
+	@ hi = lo ^ (h << 16) ^ (h >> 12), lo = h ^ (h << 20)
+	eor	r2, r3, r4, lsl #16
+	eor	r2, r2, r4, lsr #12
+	eor	r3, r4, r4, lsl #20
+
+	eor	r8, r5, r5, ror #16
+	bic	r8, r8, #0x00ff0000
+	mov	r5, r5, ror #8
+	eor	r5, r5, r8, lsr #8
+	eor	r5, r5, r2
+	eor	r5, r5, r5, lsr #16
+	eor	r2, r3, r5, lsl #16
+	eor	r2, r2, r5, lsr #12
+	eor	r3, r5, r5, lsl #20
+
+	eor	r8, r6, r6, ror #16
+	bic	r8, r8, #0x00ff0000
+	mov	r6, r6, ror #8
+	eor	r6, r6, r8, lsr #8
+	eor	r6, r6, r2
+	eor	r6, r6, r6, lsr #16
+	eor	r2, r3, r6, lsl #16
+	eor	r2, r2, r6, lsr #12
+	eor	r3, r6, r6, lsl #20
+
+	eor	r8, r7, r7, ror #16
+	bic	r8, r8, #0x00ff0000
+	mov	r7, r7, ror #8
+	eor	r7, r7, r8, lsr #8
+	eor	r7, r7, r2
+	eor	r7, r7, r7, lsr #16
+	eor	r2, r3, r7, lsl #16
+	eor	r2, r2, r7, lsr #12
+	eor	r3, r7, r7, lsl #20
+
+	subs	r9, r9, #1
+	bne	_SCSD_crc16_loop
+
+@ Store the CRC in the order it is sent on the bus
+	mov	r8, r2, lsr #24
+	strb	r8, [r1, #0]
+	mov	r8, r2, lsr #16
+	strb	r8, [r1, #1]
+	mov	r8, r2, lsr #8
+	strb	r8, [r1, #2]
+	strb	r2, [r1, #3]
+	mov	r8, r3, lsr #24
+	strb	r8, [r1, #4]
+	mov	r8, r3, lsr #16
+	strb	r8, [r1, #5]
+	mov	r8, r3, lsr #8
+	strb	r8, [r1, #6]
+	strb	r3, [r1, #7]
+
+	ldmfd	r13!, {r4-r9}
+	bx	r14
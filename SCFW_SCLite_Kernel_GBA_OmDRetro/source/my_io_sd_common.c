@@ -32,10 +32,13 @@
 */
 
 #include "my_io_sd_common.h"
+#include "systimer.h"
 
 #include <gba_console.h>
 #define MAX_STARTUP_TRIES 1000	// Arbitrary value, check if the card is ready 20 times before giving up
 #define RESPONSE_TIMEOUT 256	// Number of clocks sent to the SD card before giving up
+#define POWER_UP_TIMEOUT SYSTIMER_MS(1000)	// Time the spec gives a card to finish powering up
+#define POWER_UP_INTERVAL SYSTIMER_MS(1)	// Time between SD_APP_OP_COND polls
 
 #define iprintf(...)
 
@@ -165,7 +168,8 @@ bool _SD_InitCard_SDHC (_SD_FN_CMD_6BYTE_RESPONSE cmd_6byte_response,
 			iprintf("[%d]=%X ",i,responseBuffer[i]);
 		}
 	}
-	for (i = 0; i < MAX_STARTUP_TRIES; i++) {
+	u32 deadline = systimer_deadline(POWER_UP_TIMEOUT);
+	for (;;) {
 		cmd_6byte_response(responseBuffer, APP_CMD, 0);//CMD55
 		if (responseBuffer[0] != APP_CMD) {	
 			iprintf("Failed to send APP_CMD\n");	//进入到APP模式，可以执行ACMD41
@@ -183,10 +187,13 @@ bool _SD_InitCard_SDHC (_SD_FN_CMD_6BYTE_RESPONSE cmd_6byte_response,
 			iprintf("ACMD41 accepted init completed\n");
 			break; // Card is ready
 		}
-	}
 
-	if (i >= MAX_STARTUP_TRIES) {
-		return false;
+		if (systimer_expired(deadline)) {
+			return false;
+		}
+		// Polling any faster only keeps the card busy answering
+		u32 next = systimer_deadline(POWER_UP_INTERVAL);
+		while (!systimer_expired(next));
 	}
 	if (isSDHC) {
 		cmd_6byte_response(responseBuffer, CMD58, 0);
@@ -0,0 +1,59 @@
+#ifndef PREBUILT_H
+#define PREBUILT_H
+
+#include <gba.h>
+#include <stdio.h>
+
+// Images tools/scpack builds on a PC: the emulator core, header and game laid
+// out and patched as a launch would leave them in SDRAM, saved next to the
+// game as <game>.pbi. A launch streams one in a single pass and skips the
+// patch stage. It is used only while the game and core are the files it was
+// built from, as far as their size, write time and first bytes tell, and only
+// with the patch settings it was built for.
+//
+// Layout: struct prebuilt_header, then each struct prebuilt_block followed
+// by its bytes, then the image to the end of the file. The blocks are what
+// the patches write past the end of the image.
+#define PREBUILT_EXT ".pbi"
+#define PREBUILT_MAGIC 0x32494250	// "PBI2"
+#define PREBUILT_HASHED 512			// how much of a file its hash covers
+#define PREBUILT_BLOCK_MAX 0x1000
+
+#define PREBUILT_PATCH_WAITSTATE (1 << 0)
+#define PREBUILT_PATCH_SRAM (1 << 1)
+#define PREBUILT_PATCH_SOFT_RESET (1 << 2)
+
+// Tells a file apart from its replacement without reading all of it. The
+// hash alone misses a change past the first bytes, a copied over file also
+// gets a new write time.
+struct prebuilt_source {
+	u32 size;
+	u32 mtime;				// to the even second, what FAT keeps
+	u32 hash;
+};
+
+struct prebuilt_header {
+	u32 magic;
+	u32 patches;			// PREBUILT_PATCH_*
+	u32 image_size;
+	u32 blocks;
+	struct prebuilt_source game;
+	struct prebuilt_source core;	// all zero for a GBA game
+	char core_path[32];		// on the card, e.g. /scfw/nes.gba
+	u16 save_type;			// enum SaveType the SRAM patch found
+	u8 saving_allowed;
+	u8 reserved;
+};
+
+struct prebuilt_block {
+	u32 offset;				// from the start of SDRAM
+	u32 size;				// a multiple of 4, up to PREBUILT_BLOCK_MAX
+};
+
+// False if the file can't be read
+bool prebuilt_identify(const char *path, struct prebuilt_source *source);
+// Opens the image next to path, positioned after its header, if it is
+// current for these patches. NULL otherwise.
+FILE *prebuilt_open(const char *path, u32 patches, struct prebuilt_header *header);
+
+#endif
@@ -0,0 +1,91 @@
+#include <gba.h>
+#include <stdio.h>
+#include "profile.h"
+#include "systimer.h"
+
+#ifdef SCFW_PROFILE
+
+struct profile_record {
+	u32 start;
+	u32 calls;
+	u32 total;
+	u32 max;
+	bool running;
+};
+
+static struct profile_record records[PROFILE_PHASES];
+
+static const char *const phase_names[PROFILE_PHASES] = {
+	[PROFILE_OVERCLOCK] = "overclock_ewram",
+	[PROFILE_SD_STARTUP] = "sd_startup",
+	[PROFILE_FAT_MOUNT] = "fatMountSimple",
+	[PROFILE_SETTINGS] = "settings_load",
+	[PROFILE_AUTOSAVE] = "autosave",
+	[PROFILE_FIRST_LISTING] = "first_listing",
+	[PROFILE_FLASHROM] = "FlashROM",
+	[PROFILE_WHITESCREEN_PATCH] = "patchGeneralWhiteScreen",
+	[PROFILE_SPECIFIC_GAME_PATCH] = "patchSpecificGame",
+	[PROFILE_SAVE_FIND_TAG] = "save_findTag",
+	[PROFILE_SAVE_PATCH] = "save_patch",
+	[PROFILE_RESET_PATCH] = "resetPatch",
+	[PROFILE_L_SEQ] = "L_Seq",
+};
+
+void profile_begin(enum profile_phase phase) {
+	records[phase].running = true;
+	records[phase].start = systimer_ticks();
+}
+
+void profile_end(enum profile_phase phase) {
+	struct profile_record *record = &records[phase];
+	if (!record->running)
+		return;
+	u32 elapsed = systimer_ticks() - record->start;
+	record->running = false;
+	record->total += elapsed;
+	if (elapsed > record->max)
+		record->max = elapsed;
+	++record->calls;
+}
+
+static void profile_append(const char *path, const char *event, enum profile_phase first, enum profile_phase last) {
+	FILE *csv = fopen(path, "a");
+	if (!csv)
+		return;
+	fseek(csv, 0, SEEK_END);
+	if (!ftell(csv))
+		fiprintf(csv, "event,phase,calls,total_us,max_us\n");
+	for (int i = first; i <= last; ++i) {
+		if (!records[i].calls)
+			continue;
+		fiprintf(csv, "%s,%s,%lu,%lu,%lu\n", event, phase_names[i], records[i].calls,
+		         systimer_to_us(records[i].total), systimer_to_us(records[i].max));
+	}
+	fclose(csv);
+}
+
+void profile_report(const char *event, enum profile_phase first, enum profile_phase last) {
+	u32 total = 0;
+
+	iprintf("\x1b[2J%s profile\n%-18s%4s%8s\n", event, "phase", "n", "ms");
+	for (int i = first; i <= last; ++i) {
+		if (!records[i].calls)
+			continue;
+		// Long names are cut so a row fits the 30 column console
+		iprintf("%-18.18s%4lu%8lu\n", phase_names[i], records[i].calls, systimer_to_ms(records[i].total));
+		total += records[i].total;
+	}
+	iprintf("%-22s%8lu\n", "total", systimer_to_ms(total));
+
+	profile_append("/scfw/profile.csv", event, first, last);
+	for (int i = first; i <= last; ++i)
+		records[i] = (struct profile_record){ 0 };
+
+	iprintf("\nPress A to continue\n");
+	do {
+		VBlankIntrWait();
+		scanKeys();
+	} while (!(keysDown() & KEY_A));
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include <gba.h>
+#include <stdio.h>
+#include "progress.h"
+#include "systimer.h"
+#include "textmap.h"
+
+#define TEXT_ROW 18
+#define BAR_ROW 19
+#define COLUMNS 30
+#define FRAMES_PER_DRAW 4		// 15 redraws a second are plenty
+#define BAR_LEVELS 9			// tiles with 0 to 8 pixels of the bar filled
+
+volatile u32 progress_done;
+
+static volatile bool active;
+static u32 total;
+static u32 start;
+static u32 frames;
+
+static u16 *map;
+static u16 bar_base;
+
+static void progress_vblank();
+
+// The console's font tiles are shared with the overlay
+void progress_init() {
+	u32 char_base = (REG_BG0CNT >> 2) & 3;
+	u32 map_block = ((REG_BG0CNT >> 8) & 0x1F) == 31 ? 30 : 31;
+	u16 palette = textmap_glyph(' ') & 0xF000;
+
+	map = SCREEN_BASE_BLOCK(map_block);
+	REG_BG1CNT = BG_16_COLOR | BG_SIZE_0 | BG_PRIORITY(0) | CHAR_BASE(char_base) | SCREEN_BASE(map_block);
+	REG_BG1HOFS = 0;
+	REG_BG1VOFS = 0;
+
+	// The bar tiles go at the very end of the tile range, well past the font
+	u32 bar_tile = 1024 - BAR_LEVELS;
+	u32 *tiles = (u32 *)CHAR_BASE_BLOCK(char_base) + bar_tile * 8;
+	for (int level = 0; level < BAR_LEVELS; ++level, tiles += 8) {
+		u32 fill = level ? 0x11111111 >> (32 - 4 * level) : 0;
+		tiles[0] = tiles[7] = 0x11111111;
+		for (int row = 1; row < 7; ++row)
+			tiles[row] = fill;
+	}
+	bar_base = bar_tile | palette;
+
+	// Only the overlay shows in the bottom rows, the console everywhere else
+	REG_WIN0H = COLUMNS * 8 << 8 | 0;
+	REG_WIN0V = 160 << 8 | TEXT_ROW * 8;
+	REG_WININ = BIT(1);
+	REG_WINOUT = BIT(0);
+
+	irqSet(IRQ_VBLANK, progress_vblank);
+}
+
+static u32 put_str(u32 col, const char *s) {
+	while (*s && col < COLUMNS)
+		map[TEXT_ROW * 32 + col++] = textmap_glyph(*s++);
+	return col;
+}
+
+static u32 put_dec(u32 col, u32 n, int min_digits) {
+	char digits[11];
+	int len = 0;
+	do {
+		digits[len++] = '0' + n % 10;
+		n /= 10;
+	} while (n || len < min_digits);
+	while (len && col < COLUMNS)
+		map[TEXT_ROW * 32 + col++] = textmap_glyph(digits[--len]);
+	return col;
+}
+
+// Sizes in MB with one decimal, or in KB when the whole transfer is small
+static u32 put_size(u32 col, u32 bytes, bool mb) {
+	if (!mb)
+		return put_dec(col, bytes >> 10, 1);
+	col = put_dec(col, bytes >> 20, 1);
+	col = put_str(col, ".");
+	return put_dec(col, ((bytes & 0xFFFFF) * 10) >> 20, 1);
+}
+
+static void render() {
+	u32 done = progress_done;
+	u32 elapsed = systimer_ticks() - start;
+	bool mb = total >= 1 << 20;
+	u32 col = 0;
+
+	if (done > total)
+		done = total;
+
+	col = put_size(col, done, mb);
+	col = put_str(col, "/");
+	col = put_size(col, total, mb);
+	col = put_str(col, mb ? "MB " : "KB ");
+	if (done && elapsed) {
+		u32 rate = (u64)done * SYSTIMER_HZ * 100 / elapsed >> 20;	// hundredths of MB/s
+		u32 left = (u64)(total - done) * elapsed / done / SYSTIMER_HZ;
+		col = put_dec(col, rate / 100, 1);
+		col = put_str(col, ".");
+		col = put_dec(col, rate % 100, 2);
+		col = put_str(col, "MB/s ");
+		col = put_dec(col, left, 1);
+		col = put_str(col, "s");
+	}
+	while (col < COLUMNS)
+		col = put_str(col, " ");
+
+	u32 filled = total ? (u64)done * COLUMNS * 8 / total : 0;
+	for (col = 0; col < COLUMNS; ++col, filled = filled > 8 ? filled - 8 : 0)
+		map[BAR_ROW * 32 + col] = bar_base + (filled > 8 ? 8 : filled);
+}
+
+static void progress_vblank() {
+	if (active && !(++frames % FRAMES_PER_DRAW))
+		render();
+}
+
+void progress_draw() {
+	if (active)
+		render();
+}
+
+void progress_begin(u32 size) {
+	total = size;
+	progress_done = 0;
+	start = systimer_ticks();
+	frames = 0;
+	active = true;
+	render();
+	REG_DISPCNT |= BG1_ON | WIN0_ON;
+}
+
+void progress_end() {
+	active = false;
+	REG_DISPCNT &= ~(BG1_ON | WIN0_ON);
+}
@@ -0,0 +1,109 @@
+#include <gba.h>
+#include <stdio.h>
+#include <string.h>
+#include "recent.h"
+#include "launchlog.h"
+
+struct recent_header {
+	u32 magic;
+	u32 count;
+};
+
+EWRAM_BSS static struct recent_game games[RECENT_MAX];
+static u32 games_len;
+static bool loaded;
+static bool dirty;
+
+static void load() {
+	struct recent_header header;
+
+	loaded = true;
+	games_len = 0;
+	FILE *file = fopen(RECENT_PATH, "rb");
+	if (!file)
+		return;
+	if (fread(&header, sizeof header, 1, file) == 1 && header.magic == RECENT_MAGIC && header.count <= RECENT_MAX
+	    && fread(games, sizeof *games, header.count, file) == header.count)
+		games_len = header.count;
+	fclose(file);
+}
+
+static bool save() {
+	FILE *file = fopen(RECENT_PATH, "wb");
+	if (!file)
+		return false;
+	struct recent_header header = { RECENT_MAGIC, games_len };
+	bool ok = fwrite(&header, sizeof header, 1, file) == 1 && fwrite(games, sizeof *games, games_len, file) == games_len;
+	fclose(file);
+	if (ok)
+		dirty = false;
+	return ok;
+}
+
+static void drop(u32 n) {
+	memmove(&games[n], &games[n + 1], (games_len - n - 1) * sizeof *games);
+	--games_len;
+}
+
+static bool map(struct recent_game *game, const char *path) {
+	strcpy(game->path, path);
+	game->save_type = RECENT_SAVE_UNKNOWN;
+	game->system = launchlog_system(path);
+	return fatmap_mapFile(path, &game->file, game->extents, RECENT_EXTENTS);
+}
+
+u32 recent_count() {
+	if (!loaded)
+		load();
+	return games_len;
+}
+
+struct recent_game *recent_get(u32 n) {
+	return n < recent_count() ? &games[n] : NULL;
+}
+
+bool recent_check(struct recent_game *game) {
+	if (fatmap_unchanged(&game->file))
+		return true;
+
+	// Replaced or moved since, what was found out about it no longer holds
+	dirty = true;
+	if (map(game, game->path))
+		return true;
+	drop(game - games);
+	return false;
+}
+
+bool recent_commit(const char *path, u16 save_type) {
+	EWRAM_BSS static struct recent_game game;
+
+	if (strlen(path) >= RECENT_PATH_MAX)
+		return false;
+	u32 n = 0;
+	while (n < recent_count() && strcmp(games[n].path, path))
+		++n;
+
+	if (n < games_len) {
+		if (!recent_check(&games[n]))
+			return save();
+		if (save_type != RECENT_SAVE_UNKNOWN && games[n].save_type != save_type) {
+			games[n].save_type = save_type;
+			dirty = true;
+		}
+		if (!n)
+			return dirty ? save() : true;
+		game = games[n];
+		drop(n);
+	} else if (!map(&game, path)) {
+		return false;
+	} else {
+		game.save_type = save_type;
+		if (games_len == RECENT_MAX)
+			--games_len;
+	}
+
+	memmove(&games[1], &games[0], games_len * sizeof *games);
+	games[0] = game;
+	++games_len;
+	return save();
+}
@@ -0,0 +1,37 @@
+#ifndef RECENT_H
+#define RECENT_H
+
+#include <gba.h>
+#include "fatmap.h"
+
+// The last games launched, newest first, in /scfw/recent.bin. Each one keeps
+// where it lies on the card and what was found out about it while it was
+// loaded, so it can be started again without looking anything up. Entries
+// are checked against their directory entry when launched, and mapped again
+// then if the file changed.
+#define RECENT_PATH "/scfw/recent.bin"
+#define RECENT_MAGIC 0x31434552	// "REC1"
+#define RECENT_MAX 8
+#define RECENT_EXTENTS 8
+#define RECENT_PATH_MAX 384
+#define RECENT_SAVE_UNKNOWN 0xFFFF
+
+struct recent_game {
+	char path[RECENT_PATH_MAX];
+	struct fatmap_file file;
+	u16 save_type;		// enum SaveType, RECENT_SAVE_UNKNOWN until the SRAM patch has looked
+	u8 system;			// index into launchlog_systems
+	u8 reserved;
+	struct fatmap_extent extents[RECENT_EXTENTS];
+};
+
+// How many games there are, reading the list the first time
+u32 recent_count();
+struct recent_game *recent_get(u32 n);
+// Makes sure a game's mapping is current before it is launched. False if the
+// file is gone, it is then dropped from the list.
+bool recent_check(struct recent_game *game);
+// Moves the game being launched to the front, and writes the list if that changed it
+bool recent_commit(const char *path, u16 save_type);
+
+#endif
@@ -0,0 +1,45 @@
+#include <gba.h>
+#include <string.h>
+#include <strings.h>
+#include "romhead.h"
+
+static const char *file_name(const char *path) {
+	const char *base = strrchr(path, '/');
+	return base ? base + 1 : path;
+}
+
+static bool is_pal(const char *path) {
+	const char *name = file_name(path);
+	return strcasestr(name, "(E)") || strcasestr(name, "(EUR)") || strcasestr(name, "(Europe)");
+}
+
+u32 u32conv(const char* text) {
+    u32 result = 0;
+    for (int i = 0; i < 3; ++i) {
+        result <<= 8; // Shift left by 8 bits
+        result |= (u32)text[i]; // OR with ASCII value
+    }
+    return result;
+}
+
+// Everything not set is zero, so the same game always gets the same bytes
+void romhead_pnes(struct pnes_h *head, const char *path, u32 size) {
+	memset(head, 0, sizeof *head);
+	strncpy(head->name, file_name(path), sizeof head->name - 1);
+	head->filesize = size;
+	head->flags = is_pal(path) ? 1 << 2 : 1 << 4;
+}
+
+void romhead_smsa(struct smsa_h *head, const char *path, u32 size) {
+	u32 pathlen = strlen(path);
+	memset(head, 0, sizeof *head);
+	head->id = u32conv("SMS") | (0x1A << 24);
+	head->filesize = size;
+	if (is_pal(path))
+		head->flags |= 1 << 0;
+	if (strcasestr(file_name(path), "(J)") || strcasestr(file_name(path), "(JAPAN)"))
+		head->flags |= 1 << 1;
+	if (pathlen > 3 && !strcasecmp(path + pathlen - 3, ".gg"))
+		head->flags |= 1 << 2;
+	strncpy(head->name, file_name(path), sizeof head->name - 1);
+}
@@ -0,0 +1,123 @@
+#include <gba.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "state.h"
+#include "fatmap.h"
+#include "my_io_scsd.h"
+
+#define BYTES_PER_SECTOR 512
+#define SLOT_SECTORS (sizeof(struct kernel_state) / BYTES_PER_SECTOR)
+#define STATE_SIZE (STATE_SLOTS * sizeof(struct kernel_state))
+
+_Static_assert(sizeof(struct kernel_state) == 2 * BYTES_PER_SECTOR, "a state record must fill whole sectors");
+
+EWRAM_BSS struct kernel_state kernel_state;
+
+static struct fatmap_extent extents[STATE_SLOTS * SLOT_SECTORS];
+static u32 extents_len;
+static bool exists;
+static u32 current_slot = STATE_SLOTS - 1;
+
+static u32 checksum(struct kernel_state *state) {
+	u32 saved = state->checksum;
+	u32 hash = 0x811C9DC5;
+
+	state->checksum = 0;
+	for (u32 i = 0; i < sizeof *state; ++i) {
+		hash ^= ((u8*) state)[i];
+		hash *= 0x01000193;
+	}
+	state->checksum = saved;
+	return hash;
+}
+
+// Finds the file's sectors, so the copies can be written without libfat
+static bool map() {
+	struct stat st;
+
+	extents_len = 0;
+	exists = !stat(STATE_PATH, &st) && st.st_size == STATE_SIZE;
+	if (!exists)
+		return false;
+	extents_len = fatmap_extents(st.st_ino, STATE_SIZE, extents, sizeof extents / sizeof *extents);
+	return true;
+}
+
+static u32 sector_of(u32 n) {
+	for (u32 i = 0; i < extents_len; n -= extents[i++].sectors)
+		if (n < extents[i].sectors)
+			return extents[i].sector + n;
+	return 0;
+}
+
+// Reads or writes one copy, by sector if the file is mapped
+static bool transfer_slot(u32 slot, struct kernel_state *state, bool write) {
+	if (extents_len) {
+		u32 first = slot * SLOT_SECTORS;
+		for (u32 n = 0; n < SLOT_SECTORS; ) {
+			// Both sectors go in one command when they are next to each other
+			u32 count = 1;
+			while (n + count < SLOT_SECTORS && sector_of(first + n + count) == sector_of(first + n) + count)
+				++count;
+			u8 *data = (u8*) state + n * BYTES_PER_SECTOR;
+			if (!(write ? _my_io_scsd.writeSectors(sector_of(first + n), count, data)
+			            : _my_io_scsd.readSectors(sector_of(first + n), count, data)))
+				return false;
+			n += count;
+		}
+		return true;
+	}
+
+	FILE *file = fopen(STATE_PATH, write ? "r+b" : "rb");
+	if (!file)
+		return false;
+	fseek(file, slot * sizeof *state, SEEK_SET);
+	bool ok = (write ? fwrite(state, sizeof *state, 1, file) : fread(state, sizeof *state, 1, file)) == 1;
+	fclose(file);
+	return ok;
+}
+
+static bool create() {
+	EWRAM_BSS static struct kernel_state empty[STATE_SLOTS];
+	FILE *file = fopen(STATE_PATH, "wb");
+	if (!file)
+		return false;
+	memset(empty, 0, sizeof empty);
+	bool ok = fwrite(empty, sizeof empty, 1, file) == 1;
+	fclose(file);
+	return ok && map();
+}
+
+bool state_load() {
+	EWRAM_BSS static struct kernel_state slot;
+	bool found = false;
+
+	memset(&kernel_state, 0, sizeof kernel_state);
+	if (!map())
+		return false;
+	for (u32 i = 0; i < STATE_SLOTS; ++i) {
+		if (!transfer_slot(i, &slot, false) || slot.magic != STATE_MAGIC || slot.checksum != checksum(&slot))
+			continue;
+		if (!found || slot.seq > kernel_state.seq) {
+			kernel_state = slot;
+			current_slot = i;
+			found = true;
+		}
+	}
+	return found;
+}
+
+bool state_commit() {
+	if (!exists && !create())
+		return false;
+
+	u32 slot = (current_slot + 1) % STATE_SLOTS;
+	kernel_state.magic = STATE_MAGIC;
+	++kernel_state.seq;
+	kernel_state.checksum = checksum(&kernel_state);
+	if (!transfer_slot(slot, &kernel_state, true))
+		return false;
+	current_slot = slot;
+	return true;
+}
@@ -0,0 +1,65 @@
+#include <gba.h>
+#include <stdio.h>
+#include "textmap.h"
+
+#define MAP_WIDTH 32
+
+EWRAM_BSS static u16 shadow[TEXTMAP_ROWS][MAP_WIDTH];
+static u32 dirty_rows;
+static u16 *map;
+static u16 glyph_base;		// map entry for character 0, palette included
+
+// Rather than assume the layout of the console's font, read back what the
+// console wrote for a known character.
+void textmap_init() {
+	map = SCREEN_BASE_BLOCK((REG_BG0CNT >> 8) & 0x1F);
+
+	iprintf("0");
+	glyph_base = map[0] - '0';
+	iprintf("\x1b[2J");
+}
+
+u16 textmap_glyph(char c) {
+	return glyph_base + c;
+}
+
+void textmap_clear() {
+	u16 space = textmap_glyph(' ');
+	for (u32 row = 0; row < TEXTMAP_ROWS; ++row)
+		for (u32 col = 0; col < MAP_WIDTH; ++col)
+			shadow[row][col] = space;
+	dirty_rows = (1 << TEXTMAP_ROWS) - 1;
+}
+
+static void put(u32 row, u32 col, const char *text) {
+	u16 *out = shadow[row];
+
+	while (*text && col < TEXTMAP_COLUMNS)
+		out[col++] = textmap_glyph(*text++);
+	while (col < TEXTMAP_COLUMNS)
+		out[col++] = textmap_glyph(' ');
+	dirty_rows |= 1 << row;
+}
+
+void textmap_put_text(u32 row, const char *text) {
+	put(row, 0, text);
+}
+
+void textmap_put_item(u32 row, char marker, const char *text) {
+	shadow[row][0] = textmap_glyph(marker);
+	put(row, 1, text);
+}
+
+void textmap_present() {
+	for (u32 row = 0; dirty_rows; ++row) {
+		if (!(dirty_rows & 1 << row))
+			continue;
+		DMA_Copy(3, shadow[row], &map[row * MAP_WIDTH], DMA32 | (MAP_WIDTH * 2 / 4));
+		dirty_rows &= ~(1 << row);
+	}
+}
+
+void textmap_release() {
+	dirty_rows = 0;
+	iprintf("\x1b[2J");
+}
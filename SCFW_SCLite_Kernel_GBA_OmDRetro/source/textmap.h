@@ -0,0 +1,29 @@
+#ifndef TEXTMAP_H
+#define TEXTMAP_H
+
+#include <gba.h>
+
+// Text drawn straight into the console's tile map, for screens that are
+// redrawn on every keypress. Rows are built in a copy of the map in RAM and
+// only the ones that changed are copied to VRAM, during VBlank.
+#define TEXTMAP_COLUMNS 30
+#define TEXTMAP_ROWS 20
+
+// Call once, right after the console is set up and before anything is printed
+void textmap_init();
+
+// Map entry showing a character with the console's font and palette
+u16 textmap_glyph(char c);
+
+// Blanks every row, the next present redraws the whole screen
+void textmap_clear();
+// Writes a row of text, padded with spaces
+void textmap_put_text(u32 row, const char *text);
+// Writes a menu row, a one character marker followed by text
+void textmap_put_item(u32 row, char marker, const char *text);
+// Copies the rows written since the last call to VRAM, call it right after VBlankIntrWait
+void textmap_present();
+// Clears the screen through the console, before going back to printing with it
+void textmap_release();
+
+#endif
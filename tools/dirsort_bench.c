@@ -0,0 +1,179 @@
+/*
+ Compares the browser's directory sort against the qsort it replaced, and
+ times the letter jumps and the picker's search on the sorted listing.
+
+ Build:  cc -O2 -I tools/host -I SCFW_Kernel_GBA_OmDRetro/source -o dirsort_bench \
+             tools/dirsort_bench.c SCFW_Kernel_GBA_OmDRetro/source/dirsort.c
+ Usage:  dirsort_bench [entries...]
+
+ Lists of 512 and 4096 entries are tried by default. Names are made up to look
+ like a ROM collection: shared prefixes, mixed case, a few folders.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include "dirsort.h"
+
+#define ROUNDS 50
+
+static const char *const words[] = {
+	"Super", "super", "Mega", "Final", "Legend", "Pokemon", "pokemon", "Zelda",
+	"Mario", "Metroid", "Castlevania", "Street", "Fighter", "Advance", "Tales",
+	"The", "Golden", "Sun", "Kirby", "Wario", "Dragon", "Quest", "Fire", "Emblem"
+};
+static const char *const exts[] = { ".gba", ".gbc", ".gb", ".nes", ".sms", ".pce" };
+#define COUNT(a) (sizeof a / sizeof *a)
+
+static unsigned long comparisons;
+
+static int sort_nickname(void const *l, void const *r) {
+	++comparisons;
+	return strncasecmp(((struct dirent_brief*) l)->nickname, ((struct dirent_brief*) r)->nickname, 31);
+}
+
+static int sort_folder_nickname(void const *lv, void const *rv) {
+	const struct dirent_brief *l = lv;
+	const struct dirent_brief *r = rv;
+	if (l->isdir && !r->isdir)
+		return -1;
+	else if (!l->isdir && r->isdir)
+		return 1;
+	else
+		return sort_nickname(l, r);
+}
+
+static void make_name(char *name, u32 i) {
+	char *out = name;
+	int words_used = 1 + rand() % 4;
+	for (int w = 0; w < words_used; ++w)
+		out += sprintf(out, "%s%s", w ? " " : "", words[rand() % COUNT(words)]);
+	// Sequels and regional variants share everything up to the end
+	if (rand() % 3 == 0)
+		out += sprintf(out, " %d", 1 + rand() % 4);
+	out += sprintf(out, " (%c) [%04u]", "EUJ"[rand() % 3], i);
+	if (rand() % 16)
+		sprintf(out, "%s", exts[rand() % COUNT(exts)]);
+}
+
+static double elapsed_us(struct timespec *start) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+static int run(u32 count, bool folders_first) {
+	struct dirent_brief *entries = calloc(count, sizeof *entries);
+	struct dirent_brief *sorted = malloc(count * sizeof *sorted);
+	u32 *keys = malloc(count * sizeof *keys);
+	u16 *order = malloc(count * sizeof *order);
+	u16 *scratch = malloc(count * sizeof *scratch);
+	char name[256];
+
+	srand(count);
+	for (u32 i = 0; i < count; ++i) {
+		make_name(name, i);
+		entries[i].off = i;
+		entries[i].isdir = rand() % 16 == 0;
+		dirsort_nickname(entries[i].nickname, name, entries[i].isdir);
+		keys[i] = dirsort_key(entries[i].nickname);
+	}
+
+	struct timespec start;
+	unsigned long qsort_comparisons = 0;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int round = 0; round < ROUNDS; ++round) {
+		memcpy(sorted, entries, count * sizeof *sorted);
+		comparisons = 0;
+		qsort(sorted, count, sizeof *sorted, folders_first ? sort_folder_nickname : sort_nickname);
+		qsort_comparisons = comparisons;
+	}
+	double qsort_us = elapsed_us(&start) / ROUNDS;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int round = 0; round < ROUNDS; ++round) {
+		for (u32 i = 0; i < count; ++i)
+			order[i] = i;
+		dirsort_sort(order, scratch, count, entries, keys, folders_first);
+	}
+	double dirsort_us = elapsed_us(&start) / ROUNDS;
+
+	// Entries that compare equal may come out in either order from qsort
+	int mismatches = 0;
+	for (u32 i = 0; i < count; ++i)
+		if (strcasecmp(sorted[i].nickname, entries[order[i]].nickname) || sorted[i].isdir != entries[order[i]].isdir)
+			++mismatches;
+
+	printf("%5u entries, %-15s qsort %8.1fus (%lu compares), dirsort %8.1fus%s\n",
+		count, folders_first ? "folders first:" : "by name:", qsort_us, qsort_comparisons, dirsort_us,
+		mismatches ? ", ORDER DIFFERS" : "");
+
+	// The letter jumps and the picker, checked against walking the listing
+	struct dirsort_index index, walk = { .runs = 0 };
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int round = 0; round < ROUNDS; ++round)
+		dirsort_index_build(&index, order, count, entries, keys, folders_first);
+	double build_us = elapsed_us(&start) / ROUNDS;
+
+	u32 jumps = 0;
+	double jump_us = 0;
+	s32 pos = 0;
+	do {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		s32 next = dirsort_next_letter(&index, order, count, keys, pos);
+		jump_us += elapsed_us(&start);
+		if (next != dirsort_next_letter(&walk, order, count, keys, pos)
+		    || dirsort_prev_letter(&index, order, count, keys, next) != dirsort_prev_letter(&walk, order, count, keys, next))
+			++mismatches;
+		pos = next;
+		++jumps;
+	} while (pos && jumps <= count);
+
+	u32 finds = 0;
+	double find_us = 0;
+	for (u32 i = 0; i < count; i += 7) {
+		char prefix[8];
+		for (u32 len = 1; len < sizeof prefix; ++len) {
+			sprintf(prefix, "%.*s", (int)len, entries[order[i]].nickname);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			s32 found = dirsort_find(&index, order, count, entries, keys, prefix);
+			find_us += elapsed_us(&start);
+			if (found != dirsort_find(&walk, order, count, entries, keys, prefix))
+				++mismatches;
+			++finds;
+		}
+	}
+
+	printf("%5u entries, %-15s index %6.1fus, letter jump %5.2fus, find %5.2fus%s\n",
+		count, "", build_us, jump_us / jumps, find_us / finds,
+		mismatches ? ", RESULTS DIFFER" : "");
+
+	free(entries);
+	free(sorted);
+	free(keys);
+	free(order);
+	free(scratch);
+	return mismatches != 0;
+}
+
+int main(int argc, char **argv) {
+	static const u32 defaults[] = { 512, 4096 };
+	int failed = 0;
+
+	if (argc > 1) {
+		for (int i = 1; i < argc; ++i) {
+			u32 count = strtoul(argv[i], NULL, 0);
+			if (count == 0 || count > 0x10000) {
+				fprintf(stderr, "%s: entry count must be 1 to 65536\n", argv[i]);
+				return 2;
+			}
+			failed |= run(count, false) | run(count, true);
+		}
+	} else {
+		for (u32 i = 0; i < COUNT(defaults); ++i)
+			failed |= run(defaults[i], false) | run(defaults[i], true);
+	}
+	return failed;
+}
@@ -0,0 +1,17 @@
+// Just enough of libgba's gba.h to build the kernel's patch engine and
+// header builders on a PC. The patches write SDRAM at its GBA address, the
+// tool using them must map memory there.
+#ifndef GBA_H
+#define GBA_H
+
+#include <stdbool.h>
+#include "gba_types.h"
+
+typedef volatile u8 vu8;
+typedef volatile u16 vu16;
+typedef volatile u32 vu32;
+
+// The patches report on the kernel's console, there is none here
+#define iprintf(...) ((void) 0)
+
+#endif
@@ -0,0 +1,14 @@
+// Just enough of libgba's gba_types.h to build kernel modules on a PC
+#ifndef GBA_TYPES_H
+#define GBA_TYPES_H
+
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ Decodes the kernel's /scfw/launchlog.bin and prints launch statistics.
+
+ Build:  cc -O2 -o launchlog tools/launchlog.c
+ Usage:  launchlog [-v] launchlog.bin [more logs...]
+
+ Several logs (one per device) can be given at once, their records are pooled.
+ -v also lists every record, oldest first.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORD_SIZE 32
+#define MAX_RECORDS 65536
+
+// Must match launchlog_systems in source/launchlog.c
+static const char *const systems[] = {
+	"other", "gba", "gbc", "gb", "wsc", "ws", "pc2", "fds", "nsf", "nes",
+	"pce", "sms", "gg", "sg", "sv", "ngp", "ngc", "mpac", "mpa", "col"
+};
+#define NUM_SYSTEMS (sizeof systems / sizeof *systems)
+
+struct record {
+	uint32_t seq;
+	uint32_t path_hash;
+	uint32_t bytes_loaded;
+	uint32_t load_ms;
+	uint32_t save_bytes;
+	uint16_t patch_ms;
+	uint16_t save_ms;
+	uint16_t save_type;
+	uint16_t timeouts;
+	uint16_t crc_errors;
+	uint8_t retries;
+	uint8_t system;
+};
+
+static struct record records[MAX_RECORDS];
+static size_t num_records;
+
+static uint32_t get32(const unsigned char *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t get16(const unsigned char *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static int load(const char *path) {
+	FILE *f = fopen(path, "rb");
+	unsigned char raw[RECORD_SIZE];
+	if (!f) {
+		perror(path);
+		return 0;
+	}
+	while (num_records < MAX_RECORDS && fread(raw, RECORD_SIZE, 1, f) == 1) {
+		struct record *r = &records[num_records];
+		r->seq = get32(raw);
+		if (!r->seq)
+			continue;
+		r->path_hash = get32(raw + 4);
+		r->bytes_loaded = get32(raw + 8);
+		r->load_ms = get32(raw + 12);
+		r->save_bytes = get32(raw + 16);
+		r->patch_ms = get16(raw + 20);
+		r->save_ms = get16(raw + 22);
+		r->save_type = get16(raw + 24);
+		r->timeouts = get16(raw + 26);
+		r->crc_errors = get16(raw + 28);
+		r->retries = raw[30];
+		r->system = raw[31];
+		++num_records;
+	}
+	fclose(f);
+	return 1;
+}
+
+static const char *system_name(unsigned system) {
+	return system < NUM_SYSTEMS ? systems[system] : "?";
+}
+
+static const char *save_kind(unsigned type) {
+	switch (type >> 14) {
+	case 1: return "eeprom";
+	case 2: return type & (1 << 13) ? "flash1m" : "flash512";
+	case 3: return "sram";
+	default: return "none";
+	}
+}
+
+static int cmp_double(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static int cmp_seq(const void *a, const void *b) {
+	uint32_t x = ((const struct record *)a)->seq, y = ((const struct record *)b)->seq;
+	return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double *sorted, size_t n, double p) {
+	size_t rank = (size_t)(p / 100.0 * n + 0.999999);
+	if (rank < 1)
+		rank = 1;
+	return sorted[rank > n ? n - 1 : rank - 1];
+}
+
+static void print_stats(const char *label, double *values, size_t n, const char *unit) {
+	if (!n)
+		return;
+	qsort(values, n, sizeof *values, cmp_double);
+	printf("  %-10s p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f %s\n", label,
+	       percentile(values, n, 50), percentile(values, n, 90),
+	       percentile(values, n, 99), values[n - 1], unit);
+}
+
+// Statistics over the records for one system, or all of them when system is -1
+static void summarise(int system) {
+	static double load[MAX_RECORDS], rate[MAX_RECORDS], patch[MAX_RECORDS], save[MAX_RECORDS];
+	size_t n = 0, n_rate = 0, n_save = 0;
+	unsigned long long bytes = 0, timeouts = 0, crc_errors = 0, retries = 0;
+	unsigned long save_kinds[4] = { 0 };
+
+	for (size_t i = 0; i < num_records; ++i) {
+		const struct record *r = &records[i];
+		if (system >= 0 && r->system != system)
+			continue;
+		load[n] = r->load_ms;
+		patch[n] = r->patch_ms;
+		if (r->load_ms)
+			rate[n_rate++] = r->bytes_loaded / 1048576.0 / (r->load_ms / 1000.0);
+		if (r->save_bytes)
+			save[n_save++] = r->save_ms;
+		bytes += r->bytes_loaded;
+		timeouts += r->timeouts;
+		crc_errors += r->crc_errors;
+		retries += r->retries;
+		++save_kinds[r->save_type >> 14];
+		++n;
+	}
+	if (!n)
+		return;
+
+	printf("%s: %zu launches, %.1f MB loaded\n", system < 0 ? "all" : system_name(system), n, bytes / 1048576.0);
+	print_stats("load", load, n, "ms");
+	print_stats("speed", rate, n_rate, "MB/s");
+	print_stats("patch", patch, n, "ms");
+	print_stats("save load", save, n_save, "ms");
+	printf("  errors     %llu timeouts, %llu CRC errors, %llu retries\n", timeouts, crc_errors, retries);
+	printf("  save types ");
+	for (unsigned kind = 0; kind < 4; ++kind)
+		if (save_kinds[kind])
+			printf("%s %lu  ", save_kind(kind << 14), save_kinds[kind]);
+	printf("\n");
+}
+
+int main(int argc, char **argv) {
+	int verbose = 0, files = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "-v"))
+			verbose = 1;
+		else
+			files += load(argv[i]);
+	}
+	if (!files) {
+		fprintf(stderr, "usage: %s [-v] launchlog.bin [more logs...]\n", argv[0]);
+		return 1;
+	}
+	if (!num_records) {
+		printf("No launches recorded.\n");
+		return 0;
+	}
+
+	qsort(records, num_records, sizeof *records, cmp_seq);
+	if (verbose) {
+		printf("     seq path_hash  system  loaded_kb  load_ms  patch_ms  save_ms  save      err\n");
+		for (size_t i = 0; i < num_records; ++i) {
+			const struct record *r = &records[i];
+			printf("%8u  %08x  %-6s  %9u  %7u  %8u  %7u  %-8s  %u/%u/%u\n",
+			       r->seq, r->path_hash, system_name(r->system), r->bytes_loaded / 1024,
+			       r->load_ms, r->patch_ms, r->save_ms, save_kind(r->save_type),
+			       r->timeouts, r->crc_errors, r->retries);
+		}
+		printf("\n");
+	}
+
+	summarise(-1);
+	for (unsigned system = 0; system < NUM_SYSTEMS; ++system)
+		summarise(system);
+	return 0;
+}
@@ -0,0 +1,504 @@
+/*
+ Reports how fragmented the games, emulators and saves on a SuperCard's SD
+ card are, and rewrites them so each one lies in a single run of clusters.
+ The kernel maps such files once and streams them with multi-sector reads,
+ a file in many pieces is read through libfat a cluster run at a time.
+ Works on the card's block device or on an image of it, FAT16 or FAT32.
+
+ Build:  cc -O2 -D_FILE_OFFSET_BITS=64 -o scdefrag tools/scdefrag.c
+ Usage:  scdefrag [-v] [-w] [-p] device_or_image
+
+ Without -w nothing is written, the files that would be moved are listed.
+ -w moves every fragmented file into a free run big enough for it. The card
+    must not be mounted.
+ -p also grows saves (.sav) to the 64KB the kernel always writes, padded with
+    0xFF. The kernel writes a save of that size in place, so it stays in one
+    piece from then on. Saves for games that have none yet are not created.
+ -v lists every file looked at with how many pieces it is in.
+
+ Games of the systems the kernel launches, prebuilt images (.pbi), saves and
+ everything under /scfw are looked at. A file is moved by copying its clusters
+ to the new run, writing its new chain to every FAT, pointing its directory
+ entry at it and only then freeing the old chain: a run cut short leaves at
+ worst lost clusters for fsck to collect.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#define DIR_ENTRY_SIZE 32
+#define ATTR_VOLUME 0x08
+#define ATTR_DIRECTORY 0x10
+#define ATTR_LFN 0x0F
+#define LFN_MAX 20			// entries a long name takes at most
+#define SAVE_SIZE 0x10000
+
+// The extensions selectFile launches, see source/main.c
+static const char *const game_exts[] = {
+	".gba", ".gb", ".gbc", ".nes", ".fds", ".nsf", ".ws", ".wsc", ".pc2", ".pce",
+	".sms", ".gg", ".sg", ".sv", ".ngp", ".ngc", ".mpa", ".mpac", ".col", ".pbi"
+};
+#define NUM_GAME_EXTS (sizeof game_exts / sizeof *game_exts)
+
+static int fd;
+static off_t part_offset;
+static uint32_t bytes_per_sector;
+static uint32_t cluster_bytes;
+static uint32_t num_fats;
+static uint32_t fat_sectors;
+static uint32_t fat_start;		// sectors from the start of the partition
+static uint32_t root_start;		// FAT16, the root directory has its own sectors
+static uint32_t root_sectors;
+static uint32_t root_cluster;	// FAT32, the root directory is a cluster chain
+static uint32_t data_start;
+static uint32_t clusters;		// highest cluster number + 1
+static uint32_t fat_bits;
+static uint32_t fsinfo_sector;
+
+// The first FAT, written back a sector at a time to every copy
+static unsigned char *fat;
+static unsigned char *fat_dirty;
+static uint32_t next_free = 2;
+
+static int verbose, write_mode, grow_saves;
+static unsigned files, fragmented, moved, grown, failed;
+static int32_t allocated;
+
+static uint32_t get16(const unsigned char *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t get32(const unsigned char *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put16(unsigned char *p, uint32_t v) {
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put32(unsigned char *p, uint32_t v) {
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+static int read_at(off_t offset, void *buf, size_t len) {
+	if (pread(fd, buf, len, part_offset + offset) == (ssize_t)len)
+		return 1;
+	perror("read");
+	return 0;
+}
+
+static int write_at(off_t offset, const void *buf, size_t len) {
+	if (pwrite(fd, buf, len, part_offset + offset) == (ssize_t)len)
+		return 1;
+	perror("write");
+	return 0;
+}
+
+static off_t cluster_offset(uint32_t cluster) {
+	return ((off_t)data_start * bytes_per_sector) + (off_t)(cluster - 2) * cluster_bytes;
+}
+
+// A volume boot record rather than an MBR, as checked by libfat
+static int is_boot_sector(const unsigned char *sector) {
+	return (sector[0] == 0xEB || sector[0] == 0xE9)
+		&& (!memcmp(sector + 0x36, "FAT", 3) || !memcmp(sector + 0x52, "FAT", 3));
+}
+
+static int mount_fat(void) {
+	unsigned char sector[512];
+
+	if (!read_at(0, sector, sizeof sector) || get16(sector + 0x1FE) != 0xAA55)
+		return 0;
+	// Without a boot sector in sector 0, use the first partition of the MBR
+	if (!is_boot_sector(sector)) {
+		part_offset = (off_t)get32(sector + 0x1C6) * 512;
+		if (!read_at(0, sector, sizeof sector) || !is_boot_sector(sector))
+			return 0;
+	}
+
+	bytes_per_sector = get16(sector + 0x0B);
+	if (bytes_per_sector < 512 || bytes_per_sector > 4096 || !sector[0x0D])
+		return 0;
+	cluster_bytes = bytes_per_sector * sector[0x0D];
+	num_fats = sector[0x10];
+	fat_sectors = get16(sector + 0x16);
+	if (!fat_sectors)
+		fat_sectors = get32(sector + 0x24);
+	uint32_t total_sectors = get16(sector + 0x13);
+	if (!total_sectors)
+		total_sectors = get32(sector + 0x20);
+	root_sectors = (get16(sector + 0x11) * DIR_ENTRY_SIZE + bytes_per_sector - 1) / bytes_per_sector;
+
+	fat_start = get16(sector + 0x0E);
+	root_start = fat_start + num_fats * fat_sectors;
+	data_start = root_start + root_sectors;
+	clusters = (total_sectors - data_start) / sector[0x0D];
+	// The FAT type follows from the cluster count alone
+	fat_bits = clusters < 4085 ? 12 : clusters < 65525 ? 16 : 32;
+	clusters += 2;
+	if (fat_bits == 12) {
+		fprintf(stderr, "FAT12 is not supported\n");
+		return 0;
+	}
+	root_cluster = fat_bits == 32 ? get32(sector + 0x2C) : 0;
+	fsinfo_sector = fat_bits == 32 ? get16(sector + 0x30) : 0;
+
+	size_t fat_len = (size_t)fat_sectors * bytes_per_sector;
+	fat = malloc(fat_len);
+	fat_dirty = calloc(fat_sectors, 1);
+	return fat && fat_dirty && read_at((off_t)fat_start * bytes_per_sector, fat, fat_len);
+}
+
+static uint32_t fat_get(uint32_t cluster) {
+	return fat_bits == 16 ? get16(fat + cluster * 2) : get32(fat + cluster * 4) & 0x0FFFFFFF;
+}
+
+static void fat_set(uint32_t cluster, uint32_t value) {
+	uint32_t offset = cluster * (fat_bits / 8);
+	if (fat_bits == 16)
+		put16(fat + offset, value);
+	else
+		put32(fat + offset, (get32(fat + offset) & 0xF0000000) | value);
+	fat_dirty[offset / bytes_per_sector] = 1;
+}
+
+// The cluster after this one in its chain, 0 at the end
+static uint32_t fat_next(uint32_t cluster) {
+	uint32_t next = fat_get(cluster);
+	// Bad cluster and end of chain markers
+	if (next >= (fat_bits == 16 ? 0xFFF7 : 0x0FFFFFF7) || next < 2 || next >= clusters)
+		return 0;
+	return next;
+}
+
+static int fat_flush(void) {
+	for (uint32_t i = 0; i < fat_sectors; ++i) {
+		if (!fat_dirty[i])
+			continue;
+		for (uint32_t copy = 0; copy < num_fats; ++copy)
+			if (!write_at((off_t)(fat_start + copy * fat_sectors + i) * bytes_per_sector,
+			              fat + i * bytes_per_sector, bytes_per_sector))
+				return 0;
+		fat_dirty[i] = 0;
+	}
+	return 1;
+}
+
+// Counts the pieces of a chain holding count clusters, 0 if it is shorter
+static uint32_t count_extents(uint32_t cluster, uint32_t count) {
+	uint32_t extents = 1;
+	while (--count) {
+		uint32_t next = fat_next(cluster);
+		if (!next)
+			return 0;
+		if (next != cluster + 1)
+			++extents;
+		cluster = next;
+	}
+	return extents;
+}
+
+// First fit from where the last run was taken, wrapping around once
+static uint32_t find_run(uint32_t count) {
+	uint32_t start = next_free, run = 0;
+	for (uint32_t scanned = 0; scanned < clusters - 2 + count; ++scanned) {
+		uint32_t cluster = 2 + (next_free - 2 + scanned) % (clusters - 2);
+		if (cluster == 2)
+			run = 0;
+		if (fat_get(cluster)) {
+			run = 0;
+			continue;
+		}
+		if (!run++)
+			start = cluster;
+		if (run == count) {
+			next_free = start + count < clusters ? start + count : 2;
+			return start;
+		}
+	}
+	return 0;
+}
+
+static int ends_with(const char *name, const char *ext) {
+	size_t len = strlen(name), ext_len = strlen(ext);
+	return len > ext_len && !strcasecmp(name + len - ext_len, ext);
+}
+
+static int wanted(const char *name, int in_scfw) {
+	if (in_scfw || ends_with(name, ".sav"))
+		return 1;
+	for (size_t i = 0; i < NUM_GAME_EXTS; ++i)
+		if (ends_with(name, game_exts[i]))
+			return 1;
+	return 0;
+}
+
+// Copies a file into count clusters from start, 0xFF past its old size
+static int copy_to(uint32_t start, uint32_t first, uint32_t size, uint32_t count) {
+	unsigned char *buf = malloc(cluster_bytes);
+	uint32_t cluster = first;
+	int ok = buf != NULL;
+
+	for (uint32_t i = 0; ok && i < count; ++i) {
+		uint32_t done = i * cluster_bytes;
+		uint32_t used = size > done ? size - done : 0;
+		if (used > cluster_bytes)
+			used = cluster_bytes;
+		if (used) {
+			ok = read_at(cluster_offset(cluster), buf, cluster_bytes);
+			cluster = fat_next(cluster);
+		}
+		memset(buf + used, 0xFF, cluster_bytes - used);
+		ok = ok && write_at(cluster_offset(start + i), buf, cluster_bytes);
+	}
+	free(buf);
+	return ok;
+}
+
+// Moves a file into a single run of count clusters and points entry at it,
+// as new_size bytes long. entry_offset is where entry is on the partition.
+static int move_file(unsigned char *entry, off_t entry_offset, uint32_t first, uint32_t size, uint32_t new_size,
+                     uint32_t count) {
+	uint32_t start = find_run(count);
+	if (!start)
+		return 0;
+	if (!copy_to(start, first, size, count))
+		return 0;
+
+	for (uint32_t i = 0; i < count; ++i)
+		fat_set(start + i, i + 1 < count ? start + i + 1 : fat_bits == 16 ? 0xFFFF : 0x0FFFFFFF);
+	if (!fat_flush() || fsync(fd))
+		return 0;
+	allocated += count;
+
+	put16(entry + 0x1A, start);
+	if (fat_bits == 32)
+		put16(entry + 0x14, start >> 16);
+	put32(entry + 0x1C, new_size);
+	if (!write_at(entry_offset, entry, DIR_ENTRY_SIZE) || fsync(fd))
+		return 0;
+
+	for (uint32_t cluster = first, n = 0; cluster >= 2 && n < clusters; ++n) {
+		uint32_t next = fat_next(cluster);
+		fat_set(cluster, 0);
+		--allocated;
+		cluster = next;
+	}
+	return fat_flush();
+}
+
+static void check_file(const char *path, unsigned char *entry, off_t entry_offset) {
+	uint32_t first = get16(entry + 0x1A) | (fat_bits == 32 ? get16(entry + 0x14) << 16 : 0);
+	uint32_t size = get32(entry + 0x1C);
+	uint32_t count = (size + cluster_bytes - 1) / cluster_bytes;
+	uint32_t extents = count ? count_extents(first, count) : 0;
+	int grow = grow_saves && ends_with(path, ".sav") && size < SAVE_SIZE;
+
+	++files;
+	if (count && (first < 2 || first >= clusters || !extents)) {
+		printf("broken chain  %s\n", path);
+		++failed;
+		return;
+	}
+	if (extents > 1)
+		++fragmented;
+	if (verbose || extents > 1 || grow)
+		printf("%4u piece%s  %s%s\n", extents, extents == 1 ? " " : "s", path, grow ? " (save to grow)" : "");
+	if (!write_mode || (extents <= 1 && !grow))
+		return;
+
+	uint32_t target = grow ? (SAVE_SIZE + cluster_bytes - 1) / cluster_bytes : count;
+	if (!move_file(entry, entry_offset, count ? first : 0, size, grow ? SAVE_SIZE : size, target)) {
+		printf("  could not move, no free run of %u clusters\n", target);
+		++failed;
+		return;
+	}
+	if (grow)
+		++grown;
+	if (extents > 1)
+		++moved;
+}
+
+// Reads a directory's entries whole, with where each of its clusters lies
+static unsigned char *read_dir(uint32_t cluster, size_t *len, off_t **offsets) {
+	unsigned char *buf = NULL;
+	size_t n = 0;
+
+	*offsets = NULL;
+	if (!cluster) {
+		*len = (size_t)root_sectors * bytes_per_sector;
+		buf = malloc(*len);
+		*offsets = malloc(sizeof **offsets);
+		if (!buf || !*offsets || !read_at((off_t)root_start * bytes_per_sector, buf, *len))
+			goto fail;
+		**offsets = (off_t)root_start * bytes_per_sector;
+		return buf;
+	}
+	for (; cluster >= 2 && n < clusters; cluster = fat_next(cluster), ++n) {
+		unsigned char *grown_buf = realloc(buf, (n + 1) * cluster_bytes);
+		off_t *grown_offsets = realloc(*offsets, (n + 1) * sizeof **offsets);
+		if (grown_buf)
+			buf = grown_buf;
+		if (grown_offsets)
+			*offsets = grown_offsets;
+		if (!grown_buf || !grown_offsets || !read_at(cluster_offset(cluster), buf + n * cluster_bytes, cluster_bytes))
+			goto fail;
+		(*offsets)[n] = cluster_offset(cluster);
+	}
+	*len = n * cluster_bytes;
+	return buf;
+fail:
+	free(buf);
+	free(*offsets);
+	return NULL;
+}
+
+static unsigned char lfn_checksum(const unsigned char *entry) {
+	unsigned char sum = 0;
+	for (int i = 0; i < 11; ++i)
+		sum = ((sum & 1) << 7) + (sum >> 1) + entry[i];
+	return sum;
+}
+
+static void short_name(const unsigned char *entry, char *name) {
+	int len = 0;
+	for (int i = 0; i < 8 && entry[i] != ' '; ++i)
+		name[len++] = entry[i];
+	if (entry[8] != ' ')
+		name[len++] = '.';
+	for (int i = 8; i < 11 && entry[i] != ' '; ++i)
+		name[len++] = entry[i];
+	name[len] = '\0';
+}
+
+static void walk(uint32_t dir_cluster, const char *dir_path, int in_scfw) {
+	static const int lfn_chars[13] = { 1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30 };
+	char lfn[LFN_MAX * 13 + 1], name[sizeof lfn], path[4096];
+	int lfn_valid = 0;
+	unsigned char lfn_sum = 0;
+	size_t len;
+	off_t *offsets;
+	size_t per_block = dir_cluster ? cluster_bytes : (size_t)root_sectors * bytes_per_sector;
+
+	unsigned char *dir = read_dir(dir_cluster, &len, &offsets);
+	if (!dir) {
+		fprintf(stderr, "could not read %s\n", dir_path[0] ? dir_path : "/");
+		return;
+	}
+	for (size_t at = 0; at < len; at += DIR_ENTRY_SIZE) {
+		unsigned char *entry = dir + at;
+		if (!entry[0])
+			break;
+		if (entry[0] == 0xE5) {
+			lfn_valid = 0;
+			continue;
+		}
+		if (entry[0x0B] == ATTR_LFN) {
+			int seq = entry[0] & 0x1F;
+			if (entry[0] & 0x40) {
+				memset(lfn, 0, sizeof lfn);
+				lfn_sum = entry[0x0D];
+				lfn_valid = 1;
+			}
+			if (!seq || seq > LFN_MAX || entry[0x0D] != lfn_sum)
+				lfn_valid = 0;
+			for (int i = 0; lfn_valid && i < 13; ++i) {
+				uint32_t c = get16(entry + lfn_chars[i]);
+				if (c && c != 0xFFFF)
+					lfn[(seq - 1) * 13 + i] = c < 0x80 ? c : '?';
+			}
+			continue;
+		}
+		if (entry[0x0B] & ATTR_VOLUME) {
+			lfn_valid = 0;
+			continue;
+		}
+		if (lfn_valid && lfn_checksum(entry) == lfn_sum)
+			strcpy(name, lfn);
+		else
+			short_name(entry, name);
+		lfn_valid = 0;
+		if (!strcmp(name, ".") || !strcmp(name, ".."))
+			continue;
+
+		snprintf(path, sizeof path, "%s/%s", dir_path, name);
+		if (entry[0x0B] & ATTR_DIRECTORY) {
+			uint32_t cluster = get16(entry + 0x1A) | (fat_bits == 32 ? get16(entry + 0x14) << 16 : 0);
+			int scfw = in_scfw || (!dir_path[0] && !strcasecmp(name, "scfw"));
+			if (cluster >= 2 && cluster < clusters)
+				walk(cluster, path, scfw);
+		} else if (wanted(name, in_scfw)) {
+			check_file(path, entry, offsets[at / per_block] + at % per_block);
+		}
+	}
+	free(dir);
+	free(offsets);
+}
+
+// Keeps the free cluster count FAT32 caches in step with what was allocated
+static void update_fsinfo(void) {
+	unsigned char sector[512];
+	off_t offset = (off_t)fsinfo_sector * bytes_per_sector;
+
+	if (!fsinfo_sector || !allocated || !read_at(offset, sector, sizeof sector))
+		return;
+	if (get32(sector) != 0x41615252 || get32(sector + 0x1E4) != 0x61417272)
+		return;
+	uint32_t free_count = get32(sector + 0x1E8);
+	if (free_count != 0xFFFFFFFF)
+		put32(sector + 0x1E8, free_count - allocated);
+	write_at(offset, sector, sizeof sector);
+}
+
+int main(int argc, char **argv) {
+	const char *device = NULL;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "-v"))
+			verbose = 1;
+		else if (!strcmp(argv[i], "-w"))
+			write_mode = 1;
+		else if (!strcmp(argv[i], "-p"))
+			grow_saves = 1;
+		else
+			device = argv[i];
+	}
+	if (!device) {
+		fprintf(stderr, "usage: %s [-v] [-w] [-p] device_or_image\n", argv[0]);
+		return 1;
+	}
+
+	// O_EXCL makes opening a mounted block device fail
+	fd = open(device, write_mode ? O_RDWR | O_EXCL : O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", device, strerror(errno));
+		return 1;
+	}
+	if (!mount_fat()) {
+		fprintf(stderr, "%s: no FAT16 or FAT32 file system found\n", device);
+		return 1;
+	}
+
+	walk(root_cluster, "", 0);
+	if (write_mode) {
+		update_fsinfo();
+		fsync(fd);
+	}
+	close(fd);
+
+	printf("%u files, %u fragmented", files, fragmented);
+	if (write_mode)
+		printf(", %u moved, %u saves grown", moved, grown);
+	if (failed)
+		printf(", %u failed", failed);
+	printf("\n");
+	return failed ? 2 : 0;
+}
@@ -0,0 +1,572 @@
+/*
+ Prebuilds images for a ROM library: <game>.pbi next to each game, holding it
+ as a launch leaves it in SDRAM, emulator and header included and already
+ patched. The kernel streams one in a single pass and skips the patch stage.
+ The kernel's own header builders and patch engine do the work, on memory
+ mapped where the GBA has SDRAM.
+
+ Build:  cc -O2 -D_GNU_SOURCE -I tools/host -I SCFW_Kernel_GBA_OmDRetro/source -o scpack tools/scpack.c \
+             SCFW_Kernel_GBA_OmDRetro/source/{Save,FlashSave,EepromSave,find_common,WhiteScreenPatch}.c \
+             SCFW_Kernel_GBA_OmDRetro/source/{SoftResetPatch,irq_hook,romhead,prebuilt}.c
+ Usage:  scpack -s scfw [-p wsr] [-j jobs] [-f] game_or_folder...
+         scpack -s scfw [-p wsr] -c game.dump game
+         scpack -s scfw [-p wsr] -t game
+
+ -s is the card's /scfw folder, where the emulators are.
+ -p gives the patches the kernel has turned on: w waitstate, s SRAM, r soft
+    reset. All three by default. An image is only used with the same ones.
+ -j builds that many games at once, one per processor by default.
+ -f builds images that are already current again.
+ -c builds one game's image and compares it byte for byte with the .dump a
+    kernel built with SCFW_DUMP_IMAGE wrote when launching it.
+ -t loads one game's .pbi into SDRAM the way LaunchPrebuilt does and compares
+    all of SDRAM with what loading and patching the game leaves there. Exits
+    with 1 if the image isn't current or differs. tools/scpack_test.sh runs it.
+
+ An image is tied to the size, write time and first bytes of its game and
+ core. Write times are compared as the card stores them, so mount it without
+ a time zone offset (tz=UTC, or a UTC system clock) or no image will match.
+
+ GBA, Goomba (gb, gbc), PocketNES (nes) and SMSAdvance without BIOS (sms, gg,
+ sg) games get images. Other systems are left to the kernel to load.
+*/
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <gba.h>
+#include "Save.h"
+#include "WhiteScreenPatch.h"
+#include "SoftResetPatch.h"
+#include "romhead.h"
+#include "prebuilt.h"
+
+#define SDRAM ((u8*) 0x08000000)
+#define SDRAM_SIZE 0x02000000
+#define CHUNK 0x4000	// the kernel's filebuf, what one DMA copies
+
+// Set by the patch engine for games it won't patch the save of
+bool savingAllowed = true;
+
+struct system {
+	const char *ext;
+	const char *core;	// NULL for GBA games
+	enum { HEAD_NONE, HEAD_PNES, HEAD_SMSA } head;
+};
+
+// The launches selectFile makes for these, with default settings
+static const struct system systems[] = {
+	{ ".gba", NULL, HEAD_NONE },
+	{ ".gb", "gb.gba", HEAD_NONE },
+	{ ".gbc", "gbc.gba", HEAD_NONE },
+	{ ".nes", "nes.gba", HEAD_PNES },
+	{ ".sms", "smsa.gba", HEAD_SMSA },
+	{ ".gg", "smsa.gba", HEAD_SMSA },
+	{ ".sg", "smsa.gba", HEAD_SMSA },
+};
+#define NUM_SYSTEMS (sizeof systems / sizeof *systems)
+
+static const char *scfw_dir;
+static u32 patches = PREBUILT_PATCH_WAITSTATE | PREBUILT_PATCH_SRAM | PREBUILT_PATCH_SOFT_RESET;
+static int force;
+
+struct build {
+	u32 size;
+	u16 save_type;
+	u8 saving_allowed;
+};
+
+static const struct system *system_of(const char *path) {
+	size_t len = strlen(path);
+	for (size_t i = 0; i < NUM_SYSTEMS; ++i) {
+		size_t ext = strlen(systems[i].ext);
+		if (len > ext && !strcasecmp(path + len - ext, systems[i].ext))
+			return &systems[i];
+	}
+	return NULL;
+}
+
+static void *read_file(const char *path, u32 *size) {
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		return NULL;
+	fseek(file, 0, SEEK_END);
+	long len = ftell(file);
+	rewind(file);
+	void *data = len >= 0 && len <= SDRAM_SIZE ? malloc(len ? len : 1) : NULL;
+	if (data && fread(data, 1, len, file) != (size_t) len) {
+		free(data);
+		data = NULL;
+	}
+	fclose(file);
+	*size = len;
+	return data;
+}
+
+// As FlashROM and FlashMapped do it: whole words per chunk, so a file that
+// isn't a multiple of 4 leaves its last bytes out and shifts what follows
+static int load(u32 *total, const void *data, u32 size) {
+	for (u32 at = 0; at < size; at += CHUNK) {
+		u32 len = size - at < CHUNK ? size - at : CHUNK;
+		if ((*total & ~3) + (len & ~3) > SDRAM_SIZE)
+			return 0;
+		memcpy(SDRAM + (*total & ~3), (const u8*) data + at, len & ~3);
+		*total += len;
+	}
+	return 1;
+}
+
+static void core_path(char *path, const struct system *system) {
+	snprintf(path, PATH_MAX, "%s/%s", scfw_dir, system->core);
+}
+
+// Lays the game out in SDRAM over fill and runs FinishROM's patch stage on it
+static int build(const char *path, const struct system *system, u8 fill, struct build *out) {
+	char core[PATH_MAX];
+	u32 size;
+
+	memset(SDRAM, fill, SDRAM_SIZE);
+	u32 total = 0;
+	if (system->core) {
+		core_path(core, system);
+		void *data = read_file(core, &size);
+		if (!data) {
+			fprintf(stderr, "%s: can't read %s\n", path, core);
+			return 0;
+		}
+		int ok = load(&total, data, size);
+		free(data);
+		if (!ok)
+			return 0;
+	}
+
+	void *rom = read_file(path, &size);
+	if (!rom) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 0;
+	}
+	int ok = 1;
+	if (system->head == HEAD_PNES) {
+		struct pnes_h head;
+		romhead_pnes(&head, path, size);
+		ok = load(&total, &head, sizeof head);
+	} else if (system->head == HEAD_SMSA) {
+		struct smsa_h head;
+		romhead_smsa(&head, path, size);
+		ok = load(&total, &head, sizeof head);
+	}
+	ok = ok && load(&total, rom, size);
+	free(rom);
+	if (!ok) {
+		fprintf(stderr, "%s: too big for SDRAM\n", path);
+		return 0;
+	}
+
+	romSize = total;
+	savingAllowed = true;
+	out->save_type = SAVE_TYPE_NONE;
+	if (patches & PREBUILT_PATCH_WAITSTATE) {
+		patchGeneralWhiteScreen();
+		patchSpecificGame();
+	}
+	if (patches & PREBUILT_PATCH_SRAM) {
+		const struct save_type *saveType = savingAllowed ? save_findTag() : NULL;
+		out->save_type = saveType ? saveType->type : SAVE_TYPE_NONE;
+		if (saveType && saveType->patchFunc && !saveType->patchFunc(saveType))
+			fprintf(stderr, "%s: save type patch error\n", path);
+	}
+	if (patches & PREBUILT_PATCH_SOFT_RESET)
+		resetPatch(romSize);
+	out->size = total;
+	out->saving_allowed = savingAllowed;
+	return 1;
+}
+
+// Builds over two different fills. What the patches left alone past the
+// image differs between them, the rest they wrote, and that goes in blocks.
+// In the image itself nothing may differ, or it depended on what SDRAM held.
+static u8 *build_twice(const char *path, const struct system *system, struct build *out) {
+	struct build other;
+
+	if (!build(path, system, 0x00, out))
+		return NULL;
+	u8 *first = malloc(SDRAM_SIZE);
+	if (!first) {
+		fprintf(stderr, "%s: out of memory\n", path);
+		return NULL;
+	}
+	memcpy(first, SDRAM, SDRAM_SIZE);
+	if (!build(path, system, 0xFF, &other)) {
+		free(first);
+		return NULL;
+	}
+	if (other.size != out->size || other.save_type != out->save_type || memcmp(first, SDRAM, out->size & ~3)) {
+		fprintf(stderr, "%s: patches depend on what SDRAM held, can't prebuild\n", path);
+		free(first);
+		return NULL;
+	}
+	return first;
+}
+
+static int written(const u8 *first, u32 at) {
+	return !memcmp(first + at, SDRAM + at, 4);
+}
+
+// The next run of words the patches wrote past the image, from at on
+static int next_block(const u8 *first, u32 *at, struct prebuilt_block *block) {
+	while (*at < SDRAM_SIZE && !written(first, *at))
+		*at += 4;
+	if (*at >= SDRAM_SIZE)
+		return 0;
+	block->offset = *at;
+	while (*at < SDRAM_SIZE && written(first, *at) && *at - block->offset < PREBUILT_BLOCK_MAX)
+		*at += 4;
+	block->size = *at - block->offset;
+	return 1;
+}
+
+static int write_image(const char *path, struct prebuilt_header *header, const u8 *first) {
+	char image_path[PATH_MAX];
+	char temp_path[PATH_MAX + sizeof ".tmp"];
+	struct prebuilt_block block;
+
+	u32 start = (header->image_size + 3) & ~3;
+	header->blocks = 0;
+	for (u32 at = start; next_block(first, &at, &block); )
+		++header->blocks;
+
+	snprintf(image_path, sizeof image_path, "%s" PREBUILT_EXT, path);
+	snprintf(temp_path, sizeof temp_path, "%s.tmp", image_path);
+	FILE *file = fopen(temp_path, "wb");
+	if (!file) {
+		fprintf(stderr, "%s: %s\n", temp_path, strerror(errno));
+		return 0;
+	}
+	int ok = fwrite(header, sizeof *header, 1, file) == 1;
+	for (u32 at = start; ok && next_block(first, &at, &block); )
+		ok = fwrite(&block, sizeof block, 1, file) == 1 && fwrite(first + block.offset, 1, block.size, file) == block.size;
+	ok = ok && fwrite(first, 1, header->image_size, file) == header->image_size;
+	ok = !fclose(file) && ok;
+	if (ok && rename(temp_path, image_path))
+		ok = 0;
+	if (!ok) {
+		fprintf(stderr, "%s: can't write the image\n", image_path);
+		remove(temp_path);
+	}
+	return ok;
+}
+
+static int identify(const char *path, const struct system *system, struct prebuilt_header *header) {
+	char core[PATH_MAX];
+
+	memset(header, 0, sizeof *header);
+	header->magic = PREBUILT_MAGIC;
+	header->patches = patches;
+	if (!prebuilt_identify(path, &header->game))
+		return 0;
+	if (system->core) {
+		core_path(core, system);
+		snprintf(header->core_path, sizeof header->core_path, "/scfw/%s", system->core);
+		if (!prebuilt_identify(core, &header->core)) {
+			fprintf(stderr, "%s: can't read %s\n", path, core);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Whether the image there was built from the same files with the same patches
+static int current(const char *path, const struct prebuilt_header *header) {
+	char image_path[PATH_MAX];
+	struct prebuilt_header old;
+
+	snprintf(image_path, sizeof image_path, "%s" PREBUILT_EXT, path);
+	FILE *file = fopen(image_path, "rb");
+	if (!file)
+		return 0;
+	int same = fread(&old, sizeof old, 1, file) == 1 && old.magic == header->magic && old.patches == header->patches
+		&& !memcmp(&old.game, &header->game, sizeof old.game) && !memcmp(&old.core, &header->core, sizeof old.core)
+		&& !strncmp(old.core_path, header->core_path, sizeof old.core_path);
+	fclose(file);
+	return same;
+}
+
+static int pack(const char *path) {
+	struct prebuilt_header header;
+	struct build result;
+
+	const struct system *system = system_of(path);
+	if (!system || !identify(path, system, &header))
+		return 0;
+	if (!force && current(path, &header)) {
+		printf("current  %s\n", path);
+		return 1;
+	}
+	u8 *first = build_twice(path, system, &result);
+	if (!first)
+		return 0;
+	header.image_size = result.size;
+	header.save_type = result.save_type;
+	header.saving_allowed = result.saving_allowed;
+	int ok = write_image(path, &header, first);
+	free(first);
+	if (ok)
+		printf("built    %s\n", path);
+	return ok;
+}
+
+static int compare(const char *path, const char *dump_path) {
+	struct build result;
+	u32 dump_size;
+
+	const struct system *system = system_of(path);
+	if (!system) {
+		fprintf(stderr, "%s: not a system scpack builds\n", path);
+		return 0;
+	}
+	u8 *dump = read_file(dump_path, &dump_size);
+	if (!dump) {
+		fprintf(stderr, "%s: can't read it\n", dump_path);
+		return 0;
+	}
+	if (!build(path, system, 0x00, &result)) {
+		free(dump);
+		return 0;
+	}
+
+	u32 size = dump_size < result.size ? dump_size : result.size;
+	u32 differ = 0;
+	for (u32 i = 0; i < size; ++i) {
+		if (SDRAM[i] == dump[i])
+			continue;
+		if (differ++ < 16)
+			printf("0x%07x: image %02x, dump %02x\n", i, SDRAM[i], dump[i]);
+	}
+	free(dump);
+	if (dump_size != result.size)
+		printf("image is 0x%x bytes, dump 0x%x\n", result.size, dump_size);
+	// The dump stops at the end of the image, the blocks past it aren't in it
+	printf("%u bytes differ in 0x%x compared\n", differ, size);
+	return !differ && dump_size == result.size;
+}
+
+// Loads the image as LaunchPrebuilt does: the blocks first, then the image.
+// The core is looked for under -s, not at the card path the header gives.
+static int replay(const char *path, const struct system *system, u32 *size) {
+	char image_path[PATH_MAX];
+	struct prebuilt_header header;
+	struct prebuilt_block block;
+
+	snprintf(image_path, sizeof image_path, "%s" PREBUILT_EXT, path);
+	FILE *image = NULL;
+	if (identify(path, system, &header) && current(path, &header))
+		image = fopen(image_path, "rb");
+	if (!image || fread(&header, sizeof header, 1, image) != 1) {
+		fprintf(stderr, "%s: no current image\n", path);
+		if (image)
+			fclose(image);
+		return 0;
+	}
+	int ok = header.image_size <= SDRAM_SIZE;
+	for (u32 i = 0; ok && i < header.blocks; ++i)
+		ok = fread(&block, sizeof block, 1, image) == 1 && block.size && !(block.size & 3) && block.size <= PREBUILT_BLOCK_MAX
+			&& block.offset >= header.image_size && block.offset <= SDRAM_SIZE - block.size
+			&& fread(SDRAM + block.offset, 1, block.size, image) == block.size;
+	ok = ok && fread(SDRAM, 1, header.image_size, image) == header.image_size;
+	fclose(image);
+	if (!ok)
+		fprintf(stderr, "%s: the image is damaged\n", path);
+	*size = header.image_size;
+	return ok;
+}
+
+static int test(const char *path) {
+	struct build result;
+	u32 size;
+
+	const struct system *system = system_of(path);
+	if (!system) {
+		fprintf(stderr, "%s: not a system scpack builds\n", path);
+		return 0;
+	}
+	if (!build(path, system, 0x00, &result))
+		return 0;
+	u8 *built = malloc(SDRAM_SIZE);
+	if (!built) {
+		fprintf(stderr, "%s: out of memory\n", path);
+		return 0;
+	}
+	memcpy(built, SDRAM, SDRAM_SIZE);
+	memset(SDRAM, 0x00, SDRAM_SIZE);
+	int ok = replay(path, system, &size);
+
+	u32 differ = 0;
+	for (u32 i = 0; ok && i < SDRAM_SIZE; ++i) {
+		if (SDRAM[i] == built[i])
+			continue;
+		if (differ++ < 16)
+			printf("0x%07x: prebuilt %02x, loaded %02x\n", i, SDRAM[i], built[i]);
+	}
+	free(built);
+	if (ok && size != result.size)
+		printf("prebuilt image is 0x%x bytes, loaded 0x%x\n", size, result.size);
+	ok = ok && !differ && size == result.size;
+	printf("%s  %s\n", ok ? "same   " : "differs", path);
+	return ok;
+}
+
+struct list {
+	char **paths;
+	size_t len;
+	size_t cap;
+};
+
+static void add(struct list *list, const char *path) {
+	if (list->len == list->cap) {
+		list->cap = list->cap ? list->cap * 2 : 256;
+		list->paths = realloc(list->paths, list->cap * sizeof *list->paths);
+		if (!list->paths) {
+			perror("scpack");
+			exit(1);
+		}
+	}
+	list->paths[list->len++] = strdup(path);
+}
+
+static void walk(struct list *list, const char *path) {
+	struct stat st;
+	char child[PATH_MAX];
+
+	if (stat(path, &st)) {
+		perror(path);
+		return;
+	}
+	if (!S_ISDIR(st.st_mode)) {
+		if (system_of(path))
+			add(list, path);
+		return;
+	}
+	DIR *dir = opendir(path);
+	if (!dir) {
+		perror(path);
+		return;
+	}
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		if (dirent->d_name[0] == '.')
+			continue;
+		snprintf(child, sizeof child, "%s/%s", path, dirent->d_name);
+		walk(list, child);
+	}
+	closedir(dir);
+}
+
+static int map_sdram() {
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_FIXED_NOREPLACE
+	flags |= MAP_FIXED_NOREPLACE;
+#endif
+	void *at = mmap(SDRAM, SDRAM_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (at == SDRAM)
+		return 1;
+	fprintf(stderr, "scpack: can't map memory at %p\n", (void*) SDRAM);
+	if (at != MAP_FAILED)
+		munmap(at, SDRAM_SIZE);
+	return 0;
+}
+
+static void usage() {
+	fprintf(stderr, "usage: scpack -s scfw [-p wsr] [-j jobs] [-f] game_or_folder...\n"
+	                "       scpack -s scfw [-p wsr] -c game.dump game\n"
+	                "       scpack -s scfw [-p wsr] -t game\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	const char *dump_path = NULL;
+	int testing = 0;
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:p:j:fc:t")) != -1) {
+		switch (opt) {
+		case 's':
+			scfw_dir = optarg;
+			break;
+		case 'p':
+			patches = 0;
+			for (const char *c = optarg; *c; ++c) {
+				if (*c == 'w')
+					patches |= PREBUILT_PATCH_WAITSTATE;
+				else if (*c == 's')
+					patches |= PREBUILT_PATCH_SRAM;
+				else if (*c == 'r')
+					patches |= PREBUILT_PATCH_SOFT_RESET;
+				else if (*c != '-')
+					usage();
+			}
+			break;
+		case 'j':
+			jobs = atol(optarg);
+			break;
+		case 'f':
+			force = 1;
+			break;
+		case 'c':
+			dump_path = optarg;
+			break;
+		case 't':
+			testing = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (!scfw_dir || optind >= argc || ((dump_path || testing) && optind != argc - 1))
+		usage();
+	if (jobs < 1)
+		jobs = 1;
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	if (dump_path)
+		return map_sdram() && compare(argv[optind], dump_path) ? 0 : 1;
+	if (testing)
+		return map_sdram() && test(argv[optind]) ? 0 : 1;
+
+	struct list list = { NULL, 0, 0 };
+	for (int i = optind; i < argc; ++i)
+		walk(&list, argv[i]);
+	if ((size_t) jobs > list.len)
+		jobs = list.len ? list.len : 1;
+
+	// The patch engine works on the one SDRAM, so each job is a process with its own
+	for (long job = 0; job < jobs; ++job) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			perror("scpack");
+			return 1;
+		}
+		if (pid)
+			continue;
+		if (!map_sdram())
+			_exit(1);
+		int failed = 0;
+		for (size_t i = job; i < list.len; i += jobs)
+			failed |= !pack(list.paths[i]);
+		_exit(failed);
+	}
+
+	int failed = 0;
+	int status;
+	while (wait(&status) > 0)
+		failed |= !WIFEXITED(status) || WEXITSTATUS(status);
+	return failed;
+}
@@ -0,0 +1,83 @@
+#!/bin/sh
+# Checks scpack against the kernel's own loading and patching, on made up
+# games: every prebuilt image must leave SDRAM exactly as a normal launch
+# does, and an image must stop being current once its game or core changes.
+#
+# Usage:  tools/scpack_test.sh   (from the top of the tree, needs cc)
+
+set -e
+S=SCFW_Kernel_GBA_OmDRetro/source
+T=$(mktemp -d)
+trap 'rm -rf "$T"' EXIT
+
+cc -O2 -Wall -Werror -D_GNU_SOURCE -I tools/host -I $S -o "$T/scpack" tools/scpack.c \
+	$S/Save.c $S/FlashSave.c $S/EepromSave.c $S/find_common.c $S/WhiteScreenPatch.c \
+	$S/SoftResetPatch.c $S/irq_hook.c $S/romhead.c $S/prebuilt.c
+
+# Random bytes, with a save tag so the SRAM patch has something to find
+game() {
+	head -c "$2" /dev/urandom > "$1"
+	printf 'SRAM_V113' | dd of="$1" bs=1 seek=4096 conv=notrunc 2>/dev/null
+}
+
+mkdir "$T/scfw" "$T/games"
+# Sizes that aren't a multiple of 4 shift what follows them, as on the card
+head -c 65537 /dev/urandom > "$T/scfw/gb.gba"
+head -c 65536 /dev/urandom > "$T/scfw/gbc.gba"
+head -c 131074 /dev/urandom > "$T/scfw/nes.gba"
+head -c 98304 /dev/urandom > "$T/scfw/smsa.gba"
+game "$T/games/a.gba" 1048576
+game "$T/games/b.gba" 524289
+game "$T/games/c.gb" 262144
+game "$T/games/d.gbc" 131075
+game "$T/games/e.nes" 40976
+game "$T/games/f.sms" 262144
+game "$T/games/g.gg" 131072
+
+failed=0
+check() {
+	if ! "$T/scpack" -s "$T/scfw" "$@"; then
+		echo "FAIL: scpack $*" >&2
+		failed=1
+	fi
+}
+
+# Status of one game on a packing run: built or current
+status() {
+	"$T/scpack" -s "$T/scfw" -j 1 "$1" | awk '{ print $1 }'
+}
+
+expect() {
+	got=$(status "$2")
+	if [ "$got" != "$1" ]; then
+		echo "FAIL: $2 was $got, expected $1"
+		failed=1
+	fi
+}
+
+for patches in wsr w s r -; do
+	check -p $patches -f "$T/games" > /dev/null
+	for g in "$T"/games/*.gba "$T"/games/*.gb "$T"/games/*.gbc "$T"/games/*.nes "$T"/games/*.sms "$T"/games/*.gg; do
+		check -p $patches -t "$g" > /dev/null
+	done
+done
+
+# Back to the default patches, then change files without changing their size
+check -f "$T/games" > /dev/null
+expect current "$T/games/a.gba"
+printf 'x' | dd of="$T/games/a.gba" bs=1 seek=65536 conv=notrunc 2>/dev/null
+touch -d '2001-01-01 00:00:02' "$T/games/a.gba"
+expect built "$T/games/a.gba"
+touch -d '2001-01-01 00:00:04' "$T/scfw/nes.gba"
+expect built "$T/games/e.nes"
+expect current "$T/games/c.gb"
+# Images built for other patches aren't current
+if "$T/scpack" -s "$T/scfw" -p w -t "$T/games/c.gb" > /dev/null 2>&1; then
+	echo "FAIL: an image built for other patches was used"
+	failed=1
+fi
+
+if [ $failed = 0 ]; then
+	echo "scpack: all tests passed"
+fi
+exit $failed